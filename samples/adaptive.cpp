@@ -1,31 +1,43 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
 #include <unistd.h>
 
 #include "Model.h"
 #include "ArEncoder.h"
 #include "ArDecoder.h"
+#include "ArFrame.h"
+#include "OverlayModel.h"
 
 void printHelpMsg();
 int checkHeader(std::istream& ifs);
 void putHeader(std::ofstream& ofs);
 int decode(std::string inputFile, std::string outputFile);
-int encode(std::string inputFile, std::string outputFile);
+int encode(std::string inputFile, std::string outputFile, uint32_t interval);
+int bench(std::string inputFile);
+int benchPrimed(std::string inputFile, size_t messageSize);
 
 const std::string header = "adaptive_sample";
+const int blockSize = 1 << 16;
 
 int main(int argc, char** argv){
-	if (argc < 4){
+	if (argc < 3){
 		printHelpMsg();
 		return 0;
 	}
 
 	int e = 0;
 	int d = 0;
+	int b = 0;
+	uint32_t interval = 0;
+	size_t messageSize = 0;
 
 	int opt;
 	opterr = 0;
-	while ((opt = getopt(argc, argv, "edh")) != -1){
+	while ((opt = getopt(argc, argv, "edbk:s:h")) != -1){
 		switch(opt){
 			case 'e':
 				e = 1;
@@ -33,6 +45,19 @@ int main(int argc, char** argv){
 			case 'd':
 				d = 1;
 				break;
+			case 'b':
+				b = 1;
+				break;
+			case 'k':
+				interval = atoi(optarg);
+				break;
+			case 's':
+				b = 1;
+				messageSize = atoi(optarg);
+				if (messageSize < 1){
+					messageSize = 1;
+				}
+				break;
 			case 'h':
 				printHelpMsg();
 				return 0;
@@ -47,14 +72,18 @@ int main(int argc, char** argv){
 		}
 	}
 
-	if (e && d){
-		std::cout << "\nOnly one of -e and -d may be specified.\n";
+	if (e + d + b != 1){
+		std::cout << "\nExactly one of -e, -d, -b, and -s should be specified.\n";
+	} else if (b && messageSize){
+		benchPrimed(argv[optind], messageSize);
+	} else if (b){
+		bench(argv[optind]);
+	} else if (optind + 1 >= argc){
+		printHelpMsg();
 	} else if (e){
-		encode(argv[optind], argv[optind + 1]);
-	} else if (d){
-		decode(argv[optind], argv[optind + 1]);
+		encode(argv[optind], argv[optind + 1], interval);
 	} else{
-		std::cout << "\nExactly one of -d and -e should be specified.\n";
+		decode(argv[optind], argv[optind + 1]);
 	}
 
 	return 0;
@@ -62,13 +91,19 @@ int main(int argc, char** argv){
 
 void printHelpMsg(){
 	std::cout << "Usage: adaptive_sample <input file> <output file> -opts\n";
+	std::cout << "       adaptive_sample <input file> -b\n";
+	std::cout << "       adaptive_sample <input file> -s <message size>\n";
 	std::cout << "Options:";
 	std::cout << "\n	-e	encode";
 	std::cout << "\n	-d	decode";
-	std::cout << "\nExactly one of -d and -e should be specified.\n";
+	std::cout << "\n	-b	benchmark update intervals against updating after every character";
+	std::cout << "\n	-s N	benchmark messages of N bytes from the second half of the input, primed";
+	std::cout << "\n		from a base model of the first half, against starting from a flat model";
+	std::cout << "\n	-k K	when encoding, update the model every K characters instead of after each one";
+	std::cout << "\nExactly one of -e, -d, -b, and -s should be specified.\n";
 }
 
-int encode(std::string inputFile, std::string outputFile){
+int encode(std::string inputFile, std::string outputFile, uint32_t interval){
 	std::ifstream ifs(inputFile.c_str());
 	std::ofstream ofs(outputFile.c_str());
 
@@ -85,27 +120,25 @@ int encode(std::string inputFile, std::string outputFile){
 	putHeader(ofs);
 
 	// USAGE OF LIBRARY
-	Model m;
-	ArEncoder are(&m, &ofs);
-
-	// Initialize m with every character having a slot
-	for (int i = 0; i < 256; i++){
-		m.update(i);
-	}
+	ArFrameWriter afw(&ofs);
+	afw.putStreamHeader();
 
+	// Each frame starts from a flat model and is updated after every
+	// character, or every interval characters if one is given
+	char* block = new char[blockSize];
 	int i = 0;
-	char c = ifs.get();
-	while (ifs.good()){
-		i++;
-		are.put(c);
-		m.update(c);
-		c = ifs.get();
+	while (ifs.read(block, blockSize) || ifs.gcount() > 0){
+		i += ifs.gcount();
+		if (interval){
+			afw.putDeferredFrame((uint8_t*) block, ifs.gcount(), interval);
+		} else{
+			afw.putAdaptiveFrame((uint8_t*) block, ifs.gcount());
+		}
 	}
+	delete[] block;
 
-	// Terminate with an EOT (0x4)
-	are.put(0x4);
-
-	are.finish();
+	// No EOT is needed, the frames carry their own lengths
+	afw.finish();
 
 	// END USAGE OF LIBRARY
 
@@ -134,22 +167,25 @@ int decode(std::string inputFile, std::string outputFile){
 	}
 
 	// USAGE OF LIBRARY
-	Model m;
-	ArDecoder ard(&m, &ifs);
-
-	// Initialize m with every character having a slot
-	for (int i = 0; i < 256; i++){
-		m.update(i);
+	ArFrameReader afr(&ifs);
+	if (!afr.readStreamHeader()){
+		std::cout << "Unsupported stream version.\n";
+		return 1;
 	}
 
 	int i = 0;
-	char c;
-	c = ard.get();
-	while (c != 0x04){ // While an EOT has not been read
-		i++;
-		m.update(c);
-		ofs.put(c);
-		c = ard.get();
+	ArFrameHeader fh;
+	std::string payload;
+	std::string block;
+	while (afr.next(&fh)){
+		afr.readPayload(fh, &payload);
+		block.resize(fh.symbols);
+		if (!ArFrameReader::decodeFrame(NULL, fh, payload, (uint8_t*) &block[0])){
+			std::cout << "Unknown frame engine.\n";
+			return 1;
+		}
+		ofs.write(block.data(), block.size());
+		i += fh.symbols;
 	}
 	// END USAGE OF LIBRARY
 
@@ -158,6 +194,201 @@ int decode(std::string inputFile, std::string outputFile){
 	return 0;
 }
 
+/*
+ * Times the whole file, in frames of blockSize, with updates after every
+ * character and at a range of intervals.
+ */
+int bench(std::string inputFile){
+	std::ifstream ifs(inputFile.c_str());
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	std::string decoded(data.size(), 0);
+	std::cout << "Input: " << data.size() << " bytes\n";
+	std::cout << "Interval	Size		Bits/byte	Encode MB/s	Decode MB/s\n";
+
+	const uint32_t intervals[] = {0, 1, 16, 64, 256, 1024, 4096, 16384};
+	for (unsigned int k = 0; k < sizeof(intervals) / sizeof(intervals[0]); k++){
+		std::stringstream ss;
+		ArFrameWriter afw(&ss);
+
+		// Interval 0 stands for ENGINE_ADAPTIVE
+		std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < data.size(); i += blockSize){
+			uint32_t n = data.size() - i < (size_t) blockSize ? data.size() - i : blockSize;
+			if (intervals[k]){
+				afw.putDeferredFrame((uint8_t*) data.data() + i, n, intervals[k]);
+			} else{
+				afw.putAdaptiveFrame((uint8_t*) data.data() + i, n);
+			}
+		}
+		afw.finish();
+		std::chrono::high_resolution_clock::time_point middle = std::chrono::high_resolution_clock::now();
+
+		ArFrameReader afr(&ss);
+		ArFrameHeader fh;
+		std::string payload;
+		bool ok = true;
+		size_t pos = 0;
+		while (afr.next(&fh)){
+			afr.readPayload(fh, &payload);
+			ok = ok && ArFrameReader::decodeFrame(NULL, fh, payload, (uint8_t*) &decoded[pos]);
+			pos += fh.symbols;
+		}
+		ok = ok && decoded == data;
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+		double encSeconds = std::chrono::duration<double>(middle - begin).count();
+		double decSeconds = std::chrono::duration<double>(end - middle).count();
+
+		if (intervals[k]){
+			std::cout << intervals[k];
+		} else{
+			std::cout << "every";
+		}
+		std::cout << "\t\t" << ss.str().size();
+		std::cout << "\t\t" << 8.0 * ss.str().size() / data.size();
+		std::cout << "\t\t" << data.size() / encSeconds / 1e6;
+		std::cout << "\t\t" << data.size() / decSeconds / 1e6;
+		std::cout << (ok ? "" : "\tINCORRECT") << "\n";
+	}
+
+	return 0;
+}
+
+/*
+ * Codes the second half of the file as separate messages of messageSize
+ * bytes, each adaptive from its own start: from a flat Model, from a
+ * copy of a base Model counted from the first half, and from an
+ * OverlayModel on that base. Also times setting up each stream's model
+ * on its own, which is all that differs between the last two.
+ */
+int benchPrimed(std::string inputFile, size_t messageSize){
+	std::ifstream ifs(inputFile.c_str());
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	if (data.size() < 2){
+		std::cout << "The input must be at least 2 bytes, half to prime with and half to code.\n";
+		return 1;
+	}
+
+	const uint8_t* src = (const uint8_t*) data.data();
+	size_t half = data.size() / 2;
+
+	// USAGE OF LIBRARY
+	// Scale the first half's counts down, so that each message's updates
+	// still count for something, and give every character a slot
+	Model trained;
+	trained.ingest(src, half);
+	uint32_t norm[256] = {0};
+	trained.normalize(norm, 12);
+	Model base;
+	for (int i = 0; i < 256; i++){
+		base.update(i, norm[i] + 1);
+	}
+	base.digest();
+	// END USAGE OF LIBRARY
+
+	Model flat;
+	flat.flatten();
+
+	size_t messages = (data.size() - half + messageSize - 1) / messageSize;
+	std::cout << "Input: " << data.size() - half << " bytes in " << messages << " messages of " << messageSize << " bytes, primed from " << half << " bytes\n";
+	std::cout << "Start		Size		Bits/byte	Encode MB/s	Setup ns	Model bytes\n";
+
+	const char* names[] = {"flat", "copy", "overlay"};
+	for (int k = 0; k < 3; k++){
+		std::stringstream ss;
+		std::vector<size_t> ends;
+		size_t modelBytes = 0;
+		std::chrono::high_resolution_clock::time_point encStart = std::chrono::high_resolution_clock::now();
+		for (size_t i = half; i < data.size(); i += messageSize){
+			size_t n = data.size() - i < messageSize ? data.size() - i : messageSize;
+			if (k < 2){
+				Model m(k ? base : flat);
+				ArEncoder are(&m, &ss);
+				for (size_t j = 0; j < n; j++){
+					are.put(src[i + j]);
+					m.update(src[i + j]);
+				}
+				are.finish();
+				modelBytes += sizeof(m);
+			} else{
+				// USAGE OF LIBRARY
+				OverlayModel om(&base);
+				ArEncoder are(NULL, &ss);
+				for (size_t j = 0; j < n; j++){
+					are.put(&om, src[i + j]);
+					om.update(src[i + j]);
+				}
+				are.finish();
+				// END USAGE OF LIBRARY
+				modelBytes += om.getSize();
+			}
+			ends.push_back(ss.tellp());
+		}
+		std::chrono::high_resolution_clock::time_point encStop = std::chrono::high_resolution_clock::now();
+		double encSeconds = std::chrono::duration<double>(encStop - encStart).count();
+
+		// Each message is decoded on its own, from where the last ended
+		std::string coded = ss.str();
+		bool ok = true;
+		size_t begin = 0;
+		for (size_t i = half, e = 0; i < data.size(); i += messageSize, e++){
+			size_t n = data.size() - i < messageSize ? data.size() - i : messageSize;
+			std::stringstream in(coded.substr(begin, ends[e] - begin));
+			begin = ends[e];
+			Model m(k == 1 ? base : flat);
+			OverlayModel om(&base);
+			ArDecoder ard(&m, &in);
+			for (size_t j = 0; j < n && ok; j++){
+				uint8_t c = k < 2 ? ard.get() : ard.get(&om);
+				k < 2 ? m.update(c) : om.update(c);
+				ok = c == src[i + j];
+			}
+		}
+
+		// The setup alone, which the compiler must not skip
+		const int setups = 1 << 20;
+		uint32_t sum = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < setups; i++){
+			uint8_t c = src[i % data.size()];
+			if (k == 0){
+				Model m;
+				m.flatten();
+				sum += m.calcUpper(c, 0, ~0);
+			} else if (k == 1){
+				Model m(base);
+				sum += m.calcUpper(c, 0, ~0);
+			} else{
+				OverlayModel om(&base);
+				sum += om.calcUpper(c, 0, ~0);
+			}
+		}
+		std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+		double setupNs = std::chrono::duration<double, std::nano>(stop - start).count() / setups;
+		volatile uint32_t sink = sum;
+		(void) sink;
+
+		std::cout << names[k] << "\t\t" << coded.size();
+		std::cout << "\t\t" << 8.0 * coded.size() / (data.size() - half);
+		std::cout << "\t\t" << (data.size() - half) / encSeconds / 1e6;
+		std::cout << "\t\t" << setupNs;
+		std::cout << "\t\t" << modelBytes / messages;
+		std::cout << (ok ? "" : "\tINCORRECT") << "\n";
+	}
+
+	return 0;
+}
+
 void putHeader(std::ofstream& ofs){
 	ofs.write(header.c_str(), header.length());
 }
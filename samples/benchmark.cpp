@@ -4,15 +4,29 @@
 #include <chrono>
 #include <ctime>
 #include <cstdlib>
+#include <vector>
 
 #include "Model.h"
 #include "ArEncoder.h"
 #include "ArDecoder.h"
+#include "arc.h"
+#include "ArBatch.h"
+#include "CompactModel.h"
+#include "Kernels.h"
+#include "WideModel.h"
+#include "WideArEncoder.h"
+#include "WideArDecoder.h"
 
 uint64_t testUpdateLatency(Model* m, int numTrials, char* randomness);
 uint64_t testDigestedUpdateLatency(Model* m, int numTrials, char* randomness);
 uint64_t testEncodingLatency(Model* m, int numTrials, char* randomness, std::ostream* ostr);
 uint64_t testDecodingLatency(Model* m, int numTrials, char* expected, std::istream* istr);
+uint64_t testBufferLatency(int numTrials, char* randomness);
+bool checkKernels(const ArKernels* k, int numTrials, char* randomness);
+uint64_t testBatchLatency(Model* m, int numTrials, char* randomness, bool simd, bool decode);
+template <class M> uint64_t testManyModelsLatency(int count, int numTrials, char* randomness);
+uint64_t testWideEncodingLatency(WideModel* m, int numTrials, char* randomness, std::ostream* ostr);
+uint64_t testWideDecodingLatency(WideModel* m, int numTrials, char* expected, std::istream* istr);
 
 int main(){
 	const int numTrials = 1000000;
@@ -28,6 +42,14 @@ int main(){
 
 	uint64_t latency;
 
+	// Every vector kernel must match the scalar ones exactly
+	std::cout << "Kernels in use: " << getKernels()->name << "\n";
+	for (int level = CPU_SSE42; getKernels(level) != NULL; level++){
+		if (!checkKernels(getKernels(level), numTrials, randomness)){
+			std::cout << "Kernels differ from scalar: " << getKernels(level)->name << "\n";
+		}
+	}
+
 	std::cout << "Average latencies:\n";
 
 	latency = testUpdateLatency(&m, numTrials, randomness);
@@ -44,6 +66,48 @@ int main(){
 	latency = testDecodingLatency(&m, numTrials, randomness, &ss);
 	std::cout << "Decoding:		" << latency << " ns\n";
 
+	latency = testBufferLatency(numTrials, randomness);
+	std::cout << "Buffer round trip:	" << latency << " ns\n";
+
+	// The same trials as 64 character messages, all coded in one batch
+	ArBatch batch(&m);
+	if (batch.usesSimd()){
+		latency = testBatchLatency(&m, numTrials, randomness, true, false);
+		std::cout << "Batch encoding, AVX2:	" << latency << " ns\n";
+
+		latency = testBatchLatency(&m, numTrials, randomness, true, true);
+		std::cout << "Batch decoding, AVX2:	" << latency << " ns\n";
+	}
+
+	latency = testBatchLatency(&m, numTrials, randomness, false, false);
+	std::cout << "Batch encoding, scalar:	" << latency << " ns\n";
+
+	latency = testBatchLatency(&m, numTrials, randomness, false, true);
+	std::cout << "Batch decoding, scalar:	" << latency << " ns\n";
+
+	// Adaptive round trips spread over many live Models, as with one per
+	// connection, on 16 common characters
+	for (int count = 256; count <= 16384; count *= 8){
+		latency = testManyModelsLatency<Model>(count, numTrials, randomness);
+		std::cout << count << " Models (" << count * sizeof(Model) / 1024 << " KB):	" << latency << " ns\n";
+
+		latency = testManyModelsLatency<CompactModel>(count, numTrials, randomness);
+		std::cout << count << " CompactModels (" << count * sizeof(CompactModel) / 1024 << " KB):	" << latency << " ns\n";
+	}
+
+	// The same trials through the 64 bit coder
+	std::stringstream wss;
+	WideModel wm;
+	for (int i = 0; i < numTrials; i++){
+		wm.update(randomness[i]);
+	}
+
+	latency = testWideEncodingLatency(&wm, numTrials, randomness, &wss);
+	std::cout << "Wide encoding:		" << latency << " ns\n";
+
+	latency = testWideDecodingLatency(&wm, numTrials, randomness, &wss);
+	std::cout << "Wide decoding:		" << latency << " ns\n";
+
 	delete[] randomness;
 }
 
@@ -132,4 +196,295 @@ uint64_t testDecodingLatency(Model* m, int numTrials, char* expected, std::istre
 		std::cout << "Incorrect decoding\n";
 	}
 	return accum / numTrials;
+}
+
+/*
+ * Times arc_encode() and arc_decode() on the whole buffer, per character.
+ */
+uint64_t testBufferLatency(int numTrials, char* randomness){
+	arc_model model;
+	arc_scratch scratch;
+	arc_model_from_data(&model, (uint8_t*) randomness, numTrials);
+
+	size_t cap = arc_encode_bound(&model, numTrials);
+	uint8_t* encoded = new uint8_t[cap];
+	uint8_t* decoded = new uint8_t[numTrials];
+	size_t written;
+
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	arc_status status = arc_encode(&model, (uint8_t*) randomness, numTrials, encoded, cap, &written, &scratch);
+	if (status == ARC_OK){
+		status = arc_decode(&model, encoded, written, decoded, numTrials, &scratch);
+	}
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	if (status != ARC_OK){
+		std::cout << "Buffer coding failed: " << arc_strerror(status) << std::endl;
+	} else if (std::string((char*) decoded, numTrials) != std::string(randomness, numTrials)){
+		std::cout << "Incorrect buffer decoding\n";
+	}
+
+	delete[] encoded;
+	delete[] decoded;
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count() / numTrials;
+}
+
+/*
+ * Runs each kernel in k and the scalar kernels on the same input, and
+ * checks that they agree.
+ */
+bool checkKernels(const ArKernels* k, int numTrials, char* randomness){
+	const ArKernels* scalar = getKernels(CPU_SCALAR);
+	const uint8_t* src = (uint8_t*) randomness;
+	bool same = true;
+
+	// Odd lengths and offsets exercise the edges of the vector loops
+	for (int len = 0; len < 300; len += 7){
+		uint32_t a[256] = {0}, b[256] = {0};
+		k->histogram(src + len, len * len, a);
+		scalar->histogram(src + len, len * len, b);
+		for (int c = 0; c < 256; c++){
+			same = same && a[c] == b[c];
+		}
+	}
+
+	uint32_t a[256] = {0}, b[256] = {0};
+	k->histogram(src, numTrials, a);
+	scalar->histogram(src, numTrials, b);
+	for (int c = 0; c < 256; c++){
+		same = same && a[c] == b[c];
+	}
+
+	// Running totals, including empty and 31 bit counts
+	a[7] = b[7] = 0;
+	a[200] = b[200] = 0x7FFFFFFF - numTrials;
+	k->accumulate(a);
+	scalar->accumulate(b);
+	for (int c = 0; c < 256; c++){
+		same = same && a[c] == b[c];
+	}
+
+	for (int i = 0; i < numTrials; i += 97){
+		uint32_t value = i < numTrials / 2 ? i : (uint32_t) i << 11;
+		same = same && k->search(a, value) == scalar->search(b, value);
+	}
+	same = same && k->search(a, 0) == scalar->search(b, 0);
+	same = same && k->search(a, ~0) == scalar->search(b, ~0);
+
+	// Bounds of every character, where character 7 has no slot
+	std::vector<uint32_t> lows[2], highs[2];
+	for (int i = 0; i < 2; i++){
+		lows[i].resize(numTrials);
+		highs[i].resize(numTrials);
+	}
+	for (int len = 0; len < 300; len += 7){
+		same = same && k->gather(a, src + len, len, &lows[0][0], &highs[0][0]) == scalar->gather(b, src + len, len, &lows[1][0], &highs[1][0]);
+	}
+	same = same && k->gather(a, src, numTrials, &lows[0][0], &highs[0][0]) == scalar->gather(b, src, numTrials, &lows[1][0], &highs[1][0]);
+	same = same && lows[0] == lows[1] && highs[0] == highs[1];
+
+	k->decumulate(a);
+	scalar->decumulate(b);
+	for (int c = 0; c < 256; c++){
+		same = same && a[c] == b[c];
+	}
+
+	return same;
+}
+
+/*
+ * Times ArBatch::encode() or ArBatch::decode() on the buffer cut into 64
+ * character messages, per character. Also checks that the AVX2 lanes
+ * produce the same output as the scalar ones.
+ */
+uint64_t testBatchLatency(Model* m, int numTrials, char* randomness, bool simd, bool decode){
+	const uint32_t size = 64;
+	int n = numTrials / size;
+
+	ArBatch batch(m);
+	uint32_t cap = ArBatch::bound(size);
+	uint8_t* encoded = new uint8_t[n * cap];
+	uint8_t* reference = new uint8_t[n * cap];
+	uint8_t* decoded = new uint8_t[n * size];
+
+	const uint8_t** src = new const uint8_t*[n];
+	const uint8_t** coded = new const uint8_t*[n];
+	uint8_t** dst = new uint8_t*[n];
+	uint8_t** ref = new uint8_t*[n];
+	uint8_t** out = new uint8_t*[n];
+	uint32_t* counts = new uint32_t[n];
+	uint32_t* caps = new uint32_t[n];
+	uint32_t* written = new uint32_t[n];
+	uint32_t* refWritten = new uint32_t[n];
+
+	for (int i = 0; i < n; i++){
+		src[i] = (uint8_t*) randomness + i * size;
+		coded[i] = dst[i] = encoded + i * cap;
+		ref[i] = reference + i * cap;
+		out[i] = decoded + i * size;
+		counts[i] = size;
+		caps[i] = cap;
+	}
+
+	batch.setSimd(false);
+	batch.encode(n, src, counts, ref, caps, refWritten);
+	batch.setSimd(simd);
+
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	bool ok = batch.encode(n, src, counts, dst, caps, written);
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	if (decode){
+		begin = std::chrono::high_resolution_clock::now();
+		ok = ok && batch.decode(n, coded, written, out, counts);
+		end = std::chrono::high_resolution_clock::now();
+	}
+
+	for (int i = 0; i < n && ok; i++){
+		ok = written[i] == refWritten[i] && std::string((char*) dst[i], written[i]) == std::string((char*) ref[i], written[i]);
+	}
+	if (!ok){
+		std::cout << "Incorrect batch encoding\n";
+	} else if (decode && std::string((char*) decoded, n * size) != std::string(randomness, n * size)){
+		std::cout << "Incorrect batch decoding\n";
+	}
+
+	delete[] encoded;
+	delete[] reference;
+	delete[] decoded;
+	delete[] src;
+	delete[] coded;
+	delete[] dst;
+	delete[] ref;
+	delete[] out;
+	delete[] counts;
+	delete[] caps;
+	delete[] written;
+	delete[] refWritten;
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count() / (n * size);
+}
+
+static inline void putWith(ArEncoder* are, Model* m, uint8_t c){
+	are->setModel(m);
+	are->put(c);
+}
+
+static inline void putWith(ArEncoder* are, CompactModel* m, uint8_t c){
+	are->put(m, c);
+}
+
+static inline uint8_t getWith(ArDecoder* ard, Model* m){
+	ard->setModel(m);
+	return ard->get();
+}
+
+static inline uint8_t getWith(ArDecoder* ard, CompactModel* m){
+	return ard->get(m);
+}
+
+// Both gain ADAPT_STEP per character, and CompactModel halves its own counts
+static inline void adaptWith(Model* m, uint8_t c){
+	m->adapt(c);
+}
+
+static inline void adaptWith(CompactModel* m, uint8_t c){
+	m->update(c, ADAPT_STEP);
+}
+
+template <class M>
+uint64_t testManyModelsLatency(int count, int numTrials, char* randomness){
+	M* models = new M[count];
+	for (int i = 0; i < count; i++){
+		for (int c = 0; c < 256; c++){
+			models[i].update(c);
+		}
+	}
+
+	std::stringstream ss;
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+
+	ArEncoder are(NULL, &ss);
+	for (int i = 0; i < numTrials; i++){
+		M* m = &models[(i * 2654435761u) % count];
+		uint8_t c = randomness[i] & 0xF;
+		putWith(&are, m, c);
+		adaptWith(m, c);
+	}
+	are.finish();
+
+	delete[] models;
+	models = new M[count];
+	for (int i = 0; i < count; i++){
+		for (int c = 0; c < 256; c++){
+			models[i].update(c);
+		}
+	}
+
+	ArDecoder ard(NULL, &ss);
+	bool ok = true;
+	for (int i = 0; i < numTrials; i++){
+		M* m = &models[(i * 2654435761u) % count];
+		uint8_t c = getWith(&ard, m);
+		ok &= c == (randomness[i] & 0xF);
+		adaptWith(m, c);
+	}
+
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	if (!ok){
+		std::cout << "Incorrect decoding with many models\n";
+	}
+	delete[] models;
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count() / numTrials;
+}
+
+uint64_t testWideEncodingLatency(WideModel* m, int numTrials, char* randomness, std::ostream* ostr){
+	uint64_t accum = 0;
+
+	std::chrono::high_resolution_clock::time_point begin;
+	std::chrono::high_resolution_clock::time_point end;
+
+	WideArEncoder are(m, ostr);
+
+	for (int i = 0; i < numTrials; i++){
+		begin = std::chrono::high_resolution_clock::now();
+		are.put(randomness[i]);
+		end = std::chrono::high_resolution_clock::now();
+
+		accum += std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count();
+	}
+
+	are.finish();
+
+	return accum / numTrials;
+}
+
+uint64_t testWideDecodingLatency(WideModel* m, int numTrials, char* expected, std::istream* istr){
+	uint64_t accum = 0;
+
+	std::chrono::high_resolution_clock::time_point begin;
+	std::chrono::high_resolution_clock::time_point end;
+
+	char c;
+	bool correct = 1;
+	WideArDecoder ard(m, istr);
+
+	for (int i = 0; i < numTrials; i++){
+		begin = std::chrono::high_resolution_clock::now();
+		c = ard.get();
+		end = std::chrono::high_resolution_clock::now();
+		if (c != expected[i]){
+			correct = 0;
+		}
+
+		accum += std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count();
+	}
+
+	if (!correct){
+		std::cout << "Incorrect wide decoding\n";
+	}
+	return accum / numTrials;
 }
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <unistd.h>
+
+#include "ArFrame.h"
+#include "Bwt.h"
+
+void printHelpMsg();
+int checkHeader(std::istream& ifs);
+void putHeader(std::ofstream& ofs);
+int decode(std::string inputFile, std::string outputFile);
+int encode(std::string inputFile, std::string outputFile);
+int bench(std::string inputFile);
+
+const std::string header = "bwt_sample";
+const int blockSize = BWT_DEFAULT_BLOCK;
+
+int main(int argc, char** argv){
+	if (argc < 3){
+		printHelpMsg();
+		return 0;
+	}
+
+	int e = 0;
+	int d = 0;
+	int b = 0;
+
+	int opt;
+	opterr = 0;
+	while ((opt = getopt(argc, argv, "edbh")) != -1){
+		switch(opt){
+			case 'e':
+				e = 1;
+				break;
+			case 'd':
+				d = 1;
+				break;
+			case 'b':
+				b = 1;
+				break;
+			case 'h':
+				printHelpMsg();
+				return 0;
+			case '?':
+				std::cout << "Unknown options '-" << optopt << "'.\n";
+				printHelpMsg();
+				return 1;
+			default:
+				std::cout << "An unknown error occurred\n";
+				printHelpMsg();
+				return 1;
+		}
+	}
+
+	if (e + d + b != 1){
+		std::cout << "\nExactly one of -e, -d, and -b should be specified.\n";
+	} else if (b){
+		bench(argv[optind]);
+	} else if (optind + 1 >= argc){
+		printHelpMsg();
+	} else if (e){
+		encode(argv[optind], argv[optind + 1]);
+	} else{
+		decode(argv[optind], argv[optind + 1]);
+	}
+
+	return 0;
+}
+
+void printHelpMsg(){
+	std::cout << "Usage: bwt_sample <input file> <output file> -opts\n";
+	std::cout << "       bwt_sample <input file> -b\n";
+	std::cout << "Options:";
+	std::cout << "\n	-e	encode";
+	std::cout << "\n	-d	decode";
+	std::cout << "\n	-b	benchmark each stage, against order-0 adaptive coding";
+	std::cout << "\nExactly one of -e, -d, and -b should be specified.\n";
+}
+
+int encode(std::string inputFile, std::string outputFile){
+	std::ifstream ifs(inputFile.c_str());
+	std::ofstream ofs(outputFile.c_str());
+
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	if (!ofs.good()){
+		std::cout << "Error opening file for output.\n";
+		return 1;
+	}
+
+	putHeader(ofs);
+
+	// USAGE OF LIBRARY
+	ArFrameWriter afw(&ofs);
+	afw.putStreamHeader();
+
+	char* block = new char[blockSize];
+	int i = 0;
+	while (ifs.read(block, blockSize) || ifs.gcount() > 0){
+		i += ifs.gcount();
+		afw.putBwtFrame((uint8_t*) block, ifs.gcount());
+	}
+	delete[] block;
+
+	afw.finish();
+	// END USAGE OF LIBRARY
+
+	std::cout << "Encoded " << i << " characters.\n";
+
+	return 0;
+}
+
+int decode(std::string inputFile, std::string outputFile){
+	std::ifstream ifs(inputFile.c_str());
+	std::ofstream ofs(outputFile.c_str());
+
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	if (!ofs.good()){
+		std::cout << "Error opening file for output.\n";
+		return 1;
+	}
+
+	if (!checkHeader(ifs)){
+		std::cout << "The header does not match. Please verify that this file is in the correct format.\n";
+		return 1;
+	}
+
+	// USAGE OF LIBRARY
+	ArFrameReader afr(&ifs);
+	if (!afr.readStreamHeader()){
+		std::cout << "Unsupported stream version.\n";
+		return 1;
+	}
+
+	int i = 0;
+	ArFrameHeader fh;
+	std::string payload;
+	std::string block;
+	while (afr.next(&fh)){
+		afr.readPayload(fh, &payload);
+		block.resize(fh.symbols);
+		if (!ArFrameReader::decodeFrame(NULL, fh, payload, (uint8_t*) &block[0])){
+			std::cout << "Corrupt or unknown frame.\n";
+			return 1;
+		}
+		ofs.write(block.data(), block.size());
+		i += fh.symbols;
+	}
+	// END USAGE OF LIBRARY
+
+	std::cout << "Decoded " << i << " characters.\n";
+
+	return 0;
+}
+
+/*
+ * Times each stage of the pipeline over the whole file, in blocks of
+ * the default size, against order-0 adaptive coding.
+ */
+int bench(std::string inputFile){
+	std::ifstream ifs(inputFile.c_str());
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	std::string decoded(data.size(), 0);
+	std::cout << "Input: " << data.size() << " bytes\n";
+
+	// Order-0
+	std::stringstream order0;
+	ArFrameWriter afw(&order0);
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < data.size(); i += blockSize){
+		uint32_t count = data.size() - i < (size_t) blockSize ? data.size() - i : blockSize;
+		afw.putAdaptiveFrame((uint8_t*) data.data() + i, count);
+	}
+	double order0Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+	// BWT
+	std::stringstream ss;
+	BwtEncoder bwe(&ss);
+	for (size_t i = 0; i < data.size(); i += blockSize){
+		uint32_t count = data.size() - i < (size_t) blockSize ? data.size() - i : blockSize;
+		bwe.put((uint8_t*) data.data() + i, count);
+	}
+	bwe.finish();
+
+	BwtDecoder bwd(&ss);
+	for (size_t i = 0; i < data.size(); i += blockSize){
+		uint32_t count = data.size() - i < (size_t) blockSize ? data.size() - i : blockSize;
+		bwd.get((uint8_t*) &decoded[i], count);
+	}
+
+	const BwtTimings& enc = bwe.getTimings();
+	const BwtTimings& dec = bwd.getTimings();
+	double mb = data.size() / 1e6;
+
+	std::cout << "order-0:	" << order0.str().size() << " bytes, " << 8.0 * order0.str().size() / data.size() << " bits/byte, ";
+	std::cout << mb / order0Seconds << " MB/s\n";
+	std::cout << "bwt:		" << ss.str().size() << " bytes, " << 8.0 * ss.str().size() / data.size() << " bits/byte";
+	std::cout << (decoded == data ? "" : ", INCORRECT") << "\n";
+	std::cout << "Stage		Forward MB/s	Inverse MB/s\n";
+	std::cout << "sort		" << mb / enc.sort << "		" << mb / dec.sort << "\n";
+	std::cout << "mtf/rle		" << mb / enc.mtf << "		" << mb / dec.mtf << "\n";
+	std::cout << "coding		" << mb / enc.code << "		" << mb / dec.code << "\n";
+	std::cout << "total		" << mb / (enc.sort + enc.mtf + enc.code) << "		" << mb / (dec.sort + dec.mtf + dec.code) << "\n";
+
+	return 0;
+}
+
+void putHeader(std::ofstream& ofs){
+	ofs.write(header.c_str(), header.length());
+}
+
+int checkHeader(std::istream& ifs){
+	char* buf = new char[header.length() + 1];
+	ifs.read(buf, header.length());
+	buf[header.length()] = '\0'; // Null terminate
+
+	int ret = (header == std::string(buf));
+	delete[] buf;
+	return ret;
+}
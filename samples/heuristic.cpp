@@ -5,6 +5,7 @@
 #include "Model.h"
 #include "ArEncoder.h"
 #include "ArDecoder.h"
+#include "ArFrame.h"
 
 void printHelpMsg();
 int checkHeader(std::istream& ifs);
@@ -14,6 +15,7 @@ int decode(std::string inputFile, std::string outputFile);
 int encode(std::string inputFile, std::string outputFile);
 
 const std::string header = "heuristic_sample";
+const int blockSize = 1 << 16;
 
 int main(int argc, char** argv){
 	if (argc < 4){
@@ -87,22 +89,22 @@ int encode(std::string inputFile, std::string outputFile){
 
 	// USAGE OF LIBRARY
 	Model m;
-	ArEncoder are(&m, &ofs);
 	initModel(&m);
 
+	ArFrameWriter afw(&ofs);
+	afw.putStreamHeader();
+
+	char* block = new char[blockSize];
 	int i = 0;
-	char c = ifs.get();
-	while (ifs.good()){
-		i++;
-		are.put(c);
-		c = ifs.get();
+	while (ifs.read(block, blockSize) || ifs.gcount() > 0){
+		i += ifs.gcount();
+		afw.putFrame(&m, (uint8_t*) block, ifs.gcount());
 	}
+	delete[] block;
 	std::cout << "Encoded " << i << " characters.\n";
 
-	// Terminate with an EOT (0x4)
-	are.put(0x4);
-
-	are.finish();
+	// No EOT is needed, the frames carry their own lengths
+	afw.finish();
 
 	// END USAGE OF LIBRARY
 
@@ -130,16 +132,27 @@ int decode(std::string inputFile, std::string outputFile){
 
 	// USAGE OF LIBRARY
 	Model m;
-	ArDecoder ard(&m, &ifs);
 	initModel(&m);
 
+	ArFrameReader afr(&ifs);
+	if (!afr.readStreamHeader()){
+		std::cout << "Unsupported stream version.\n";
+		return 1;
+	}
+
 	int i = 0;
-	char c;
-	c = ard.get();
-	while (c != 0x04){ // While an EOT has not been read
-		ofs.put(c);
-		c = ard.get();
-		i++;
+	ArFrameHeader fh;
+	std::string payload;
+	std::string block;
+	while (afr.next(&fh)){
+		afr.readPayload(fh, &payload);
+		block.resize(fh.symbols);
+		if (!ArFrameReader::decodeFrame(&m, fh, payload, (uint8_t*) &block[0])){
+			std::cout << "Unknown frame engine.\n";
+			return 1;
+		}
+		ofs.write(block.data(), block.size());
+		i += fh.symbols;
 	}
 	// END USAGE OF LIBRARY
 
@@ -259,7 +272,11 @@ void initModel(Model* m){
 	m->update('}', 2);
 	m->update('~', 1);
 
-	m->update(0x4, 1);	// For termination
+	// Give every character a slot so that files outside the heuristic
+	// (such as binaries) still decode correctly
+	for (int i = 0; i < 256; i++){
+		m->update(i);
+	}
 
 	// END USAGE OF LIBRARY
 }
\ No newline at end of file
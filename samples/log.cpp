@@ -0,0 +1,226 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <vector>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "ArLog.h"
+#include "ArFrame.h"
+
+void printHelpMsg();
+int append(std::string inputFile, std::string logFile);
+int decode(std::string logFile, std::string outputFile);
+int bench(std::string inputFile, int pieces);
+bool appendOnce(std::string logFile, const uint8_t* src, size_t count);
+
+const int chunkSize = 4096;
+
+int main(int argc, char** argv){
+	if (argc < 3){
+		printHelpMsg();
+		return 0;
+	}
+
+	int a = 0;
+	int d = 0;
+	int b = 0;
+	int pieces = 16;
+
+	int opt;
+	opterr = 0;
+	while ((opt = getopt(argc, argv, "adb:h")) != -1){
+		switch(opt){
+			case 'a':
+				a = 1;
+				break;
+			case 'd':
+				d = 1;
+				break;
+			case 'b':
+				b = 1;
+				pieces = atoi(optarg);
+				if (pieces < 1){
+					pieces = 1;
+				}
+				break;
+			case 'h':
+				printHelpMsg();
+				return 0;
+			case '?':
+				std::cout << "Unknown options '-" << (char) optopt << "'.\n";
+				printHelpMsg();
+				return 1;
+			default:
+				std::cout << "An unknown error occurred\n";
+				printHelpMsg();
+				return 1;
+		}
+	}
+
+	if (b){
+		return bench(argv[optind], pieces);
+	}
+
+	if (argc < 4){
+		printHelpMsg();
+		return 0;
+	}
+
+	if (a && d){
+		std::cout << "\nOnly one of -a and -d may be specified.\n";
+	} else if (a){
+		return append(argv[optind], argv[optind + 1]);
+	} else if (d){
+		return decode(argv[optind], argv[optind + 1]);
+	} else{
+		std::cout << "\nExactly one of -a and -d should be specified.\n";
+	}
+
+	return 0;
+}
+
+void printHelpMsg(){
+	std::cout << "Usage: log_sample <input file> <log file> -a\n";
+	std::cout << "       log_sample <log file> <output file> -d\n";
+	std::cout << "       log_sample <input file> -b <pieces>\n";
+	std::cout << "Options:";
+	std::cout << "\n	-a	append the input to the log, creating it if need be";
+	std::cout << "\n	-d	decode the whole log";
+	std::cout << "\n	-b	append the input in pieces, reopening the log for each, and compare";
+	std::cout << "\n		with starting a new stream for each piece";
+	std::cout << "\nExactly one of -a, -d, and -b should be specified.\n";
+}
+
+int append(std::string inputFile, std::string logFile){
+	std::ifstream ifs(inputFile.c_str(), std::ios::binary);
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	if (!appendOnce(logFile, (const uint8_t*) data.data(), data.size())){
+		std::cout << "Error appending to the log. Is it a log?\n";
+		return 1;
+	}
+
+	std::ifstream log(logFile.c_str(), std::ios::binary | std::ios::ate);
+	std::cout << "Appended " << data.size() << " characters. The log is " << log.tellg() << " bytes.\n";
+
+	return 0;
+}
+
+/*
+ * Opens the log (or creates it), carries on its stream with count
+ * characters from src, and closes it again, as a log writer would on
+ * each rotation.
+ */
+bool appendOnce(std::string logFile, const uint8_t* src, size_t count){
+	// An fstream opened for reading and writing must exist already
+	std::ofstream(logFile.c_str(), std::ios::binary | std::ios::app);
+	std::fstream file(logFile.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+
+	// USAGE OF LIBRARY
+	ArLogWriter alw(&file);
+	if (!alw.open()){
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i += chunkSize){
+		size_t n = count - i < (size_t) chunkSize ? count - i : chunkSize;
+		alw.put(src + i, n);
+	}
+
+	return alw.checkpoint();
+	// END USAGE OF LIBRARY
+}
+
+int decode(std::string logFile, std::string outputFile){
+	std::ifstream ifs(logFile.c_str(), std::ios::binary);
+	std::ofstream ofs(outputFile.c_str(), std::ios::binary);
+
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	if (!ofs.good()){
+		std::cout << "Error opening file for output.\n";
+		return 1;
+	}
+
+	// USAGE OF LIBRARY
+	ArLogReader alr(&ifs);
+	if (!alr.open()){
+		std::cout << "The file is not a log.\n";
+		return 1;
+	}
+
+	std::vector<uint8_t> buf(chunkSize);
+	size_t n;
+	while ((n = alr.get(&buf[0], buf.size())) > 0){
+		ofs.write((char*) &buf[0], n);
+	}
+	// END USAGE OF LIBRARY
+
+	std::cout << "Decoded " << alr.getSymbols() << " characters.\n";
+
+	return 0;
+}
+
+/*
+ * Appends the input to a new log in pieces, reopening it for each, and
+ * checks that it decodes. Then codes each piece as a separate adaptive
+ * frame, which is what rotating to a new stream each time would cost.
+ */
+int bench(std::string inputFile, int pieces){
+	std::ifstream ifs(inputFile.c_str(), std::ios::binary);
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	const uint8_t* src = (const uint8_t*) data.data();
+	size_t piece = data.size() / pieces + 1;
+
+	std::string logFile = inputFile + ".log_sample";
+	std::ofstream(logFile.c_str(), std::ios::binary | std::ios::trunc);
+	for (size_t i = 0; i < data.size(); i += piece){
+		size_t n = data.size() - i < piece ? data.size() - i : piece;
+		if (!appendOnce(logFile, src + i, n)){
+			std::cout << "Error appending to the log.\n";
+			return 1;
+		}
+	}
+
+	std::ifstream log(logFile.c_str(), std::ios::binary);
+	std::string decoded(data.size(), 0);
+	// USAGE OF LIBRARY
+	ArLogReader alr(&log);
+	bool ok = alr.open() && alr.getSymbols() == data.size();
+	ok = ok && alr.get((uint8_t*) &decoded[0], decoded.size()) == decoded.size();
+	// END USAGE OF LIBRARY
+	ok = ok && decoded == data;
+	log.clear();
+	log.seekg(0, std::ios::end);
+	size_t logSize = log.tellg();
+	unlink(logFile.c_str());
+
+	std::stringstream ss;
+	ArFrameWriter afw(&ss);
+	afw.putStreamHeader();
+	for (size_t i = 0; i < data.size(); i += piece){
+		size_t n = data.size() - i < piece ? data.size() - i : piece;
+		afw.putAdaptiveFrame(src + i, n);
+	}
+	afw.finish();
+
+	std::cout << "Input: " << data.size() << " bytes, in " << pieces << " pieces\n";
+	std::cout << "Appended log:		" << logSize << " bytes (" << LOG_TRAILER_SIZE << " of trailer)" << (ok ? "" : "	INCORRECT") << "\n";
+	std::cout << "New stream per piece:	" << ss.str().size() << " bytes\n";
+
+	return 0;
+}
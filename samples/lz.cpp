@@ -0,0 +1,237 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "ArFrame.h"
+#include "Lz.h"
+
+void printHelpMsg();
+int checkHeader(std::istream& ifs);
+void putHeader(std::ofstream& ofs);
+int decode(std::string inputFile, std::string outputFile);
+int encode(std::string inputFile, std::string outputFile, int level);
+int bench(std::string inputFile);
+
+const std::string header = "lz_sample";
+const int blockSize = 1 << 22;
+
+int main(int argc, char** argv){
+	if (argc < 3){
+		printHelpMsg();
+		return 0;
+	}
+
+	int e = 0;
+	int d = 0;
+	int b = 0;
+	int level = LZ_DEFAULT_LEVEL;
+
+	int opt;
+	opterr = 0;
+	while ((opt = getopt(argc, argv, "edbl:h")) != -1){
+		switch(opt){
+			case 'e':
+				e = 1;
+				break;
+			case 'd':
+				d = 1;
+				break;
+			case 'b':
+				b = 1;
+				break;
+			case 'l':
+				level = atoi(optarg);
+				break;
+			case 'h':
+				printHelpMsg();
+				return 0;
+			case '?':
+				std::cout << "Unknown options '-" << optopt << "'.\n";
+				printHelpMsg();
+				return 1;
+			default:
+				std::cout << "An unknown error occurred\n";
+				printHelpMsg();
+				return 1;
+		}
+	}
+
+	if (e + d + b != 1){
+		std::cout << "\nExactly one of -e, -d, and -b should be specified.\n";
+	} else if (b){
+		bench(argv[optind]);
+	} else if (optind + 1 >= argc){
+		printHelpMsg();
+	} else if (e){
+		encode(argv[optind], argv[optind + 1], level);
+	} else{
+		decode(argv[optind], argv[optind + 1]);
+	}
+
+	return 0;
+}
+
+void printHelpMsg(){
+	std::cout << "Usage: lz_sample <input file> <output file> -opts\n";
+	std::cout << "       lz_sample <input file> -b\n";
+	std::cout << "Options:";
+	std::cout << "\n	-e	encode";
+	std::cout << "\n	-d	decode";
+	std::cout << "\n	-l <n>	level, from " << LZ_MIN_LEVEL << " (fastest) to " << LZ_MAX_LEVEL << " (smallest), default " << LZ_DEFAULT_LEVEL;
+	std::cout << "\n	-b	benchmark every level against order-0 adaptive coding";
+	std::cout << "\nExactly one of -e, -d, and -b should be specified.\n";
+}
+
+int encode(std::string inputFile, std::string outputFile, int level){
+	std::ifstream ifs(inputFile.c_str());
+	std::ofstream ofs(outputFile.c_str());
+
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	if (!ofs.good()){
+		std::cout << "Error opening file for output.\n";
+		return 1;
+	}
+
+	putHeader(ofs);
+
+	// USAGE OF LIBRARY
+	ArFrameWriter afw(&ofs);
+	afw.putStreamHeader();
+
+	char* block = new char[blockSize];
+	int i = 0;
+	while (ifs.read(block, blockSize) || ifs.gcount() > 0){
+		i += ifs.gcount();
+		afw.putLzFrame((uint8_t*) block, ifs.gcount(), level);
+	}
+	delete[] block;
+
+	afw.finish();
+	// END USAGE OF LIBRARY
+
+	std::cout << "Encoded " << i << " characters.\n";
+
+	return 0;
+}
+
+int decode(std::string inputFile, std::string outputFile){
+	std::ifstream ifs(inputFile.c_str());
+	std::ofstream ofs(outputFile.c_str());
+
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	if (!ofs.good()){
+		std::cout << "Error opening file for output.\n";
+		return 1;
+	}
+
+	if (!checkHeader(ifs)){
+		std::cout << "The header does not match. Please verify that this file is in the correct format.\n";
+		return 1;
+	}
+
+	// USAGE OF LIBRARY
+	ArFrameReader afr(&ifs);
+	if (!afr.readStreamHeader()){
+		std::cout << "Unsupported stream version.\n";
+		return 1;
+	}
+
+	int i = 0;
+	ArFrameHeader fh;
+	std::string payload;
+	std::string block;
+	while (afr.next(&fh)){
+		afr.readPayload(fh, &payload);
+		block.resize(fh.symbols);
+		if (!ArFrameReader::decodeFrame(NULL, fh, payload, (uint8_t*) &block[0])){
+			std::cout << "Corrupt or unknown frame.\n";
+			return 1;
+		}
+		ofs.write(block.data(), block.size());
+		i += fh.symbols;
+	}
+	// END USAGE OF LIBRARY
+
+	std::cout << "Decoded " << i << " characters.\n";
+
+	return 0;
+}
+
+/*
+ * Times one frame of the whole file through each engine and level.
+ */
+int bench(std::string inputFile){
+	std::ifstream ifs(inputFile.c_str());
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	std::string decoded(data.size(), 0);
+	std::cout << "Input: " << data.size() << " bytes\n";
+	std::cout << "Mode		Size		Bits/byte	Encode MB/s	Decode MB/s\n";
+
+	for (int level = LZ_MIN_LEVEL - 1; level <= LZ_MAX_LEVEL; level++){
+		std::stringstream ss;
+		ArFrameWriter afw(&ss);
+
+		// Level 0 stands for the plain order-0 path
+		std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+		if (level == 0){
+			afw.putAdaptiveFrame((uint8_t*) data.data(), data.size());
+		} else{
+			afw.putLzFrame((uint8_t*) data.data(), data.size(), level);
+		}
+		std::chrono::high_resolution_clock::time_point middle = std::chrono::high_resolution_clock::now();
+
+		ArFrameReader afr(&ss);
+		ArFrameHeader fh;
+		std::string payload;
+		afr.next(&fh);
+		afr.readPayload(fh, &payload);
+		bool ok = ArFrameReader::decodeFrame(NULL, fh, payload, (uint8_t*) &decoded[0]) && decoded == data;
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+		double encSeconds = std::chrono::duration<double>(middle - begin).count();
+		double decSeconds = std::chrono::duration<double>(end - middle).count();
+
+		if (level == 0){
+			std::cout << "order-0";
+		} else{
+			std::cout << "lz -l " << level;
+		}
+		std::cout << "\t\t" << ss.str().size();
+		std::cout << "\t\t" << 8.0 * ss.str().size() / data.size();
+		std::cout << "\t\t" << data.size() / encSeconds / 1e6;
+		std::cout << "\t\t" << data.size() / decSeconds / 1e6;
+		std::cout << (ok ? "" : "\tINCORRECT") << "\n";
+	}
+
+	return 0;
+}
+
+void putHeader(std::ofstream& ofs){
+	ofs.write(header.c_str(), header.length());
+}
+
+int checkHeader(std::istream& ifs){
+	char* buf = new char[header.length() + 1];
+	ifs.read(buf, header.length());
+	buf[header.length()] = '\0'; // Null terminate
+
+	int ret = (header == std::string(buf));
+	delete[] buf;
+	return ret;
+}
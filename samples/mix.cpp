@@ -0,0 +1,250 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "ArFrame.h"
+#include "Lz.h"
+#include "Mix.h"
+
+void printHelpMsg();
+int checkHeader(std::istream& ifs);
+void putHeader(std::ofstream& ofs);
+int decode(std::string inputFile, std::string outputFile);
+int encode(std::string inputFile, std::string outputFile, int tableBits);
+int bench(std::string inputFile, int tableBits);
+void benchFrames(const std::string& data, uint8_t engine, int tableBits, const char* name);
+
+const std::string header = "mix_sample";
+const int blockSize = 1 << 24;
+
+int main(int argc, char** argv){
+	if (argc < 3){
+		printHelpMsg();
+		return 0;
+	}
+
+	int e = 0;
+	int d = 0;
+	int b = 0;
+	int tableBits = MIX_DEFAULT_BITS;
+
+	int opt;
+	opterr = 0;
+	while ((opt = getopt(argc, argv, "edbm:h")) != -1){
+		switch(opt){
+			case 'e':
+				e = 1;
+				break;
+			case 'd':
+				d = 1;
+				break;
+			case 'b':
+				b = 1;
+				break;
+			case 'm':
+				tableBits = atoi(optarg);
+				break;
+			case 'h':
+				printHelpMsg();
+				return 0;
+			case '?':
+				std::cout << "Unknown options '-" << optopt << "'.\n";
+				printHelpMsg();
+				return 1;
+			default:
+				std::cout << "An unknown error occurred\n";
+				printHelpMsg();
+				return 1;
+		}
+	}
+
+	if (e + d + b != 1){
+		std::cout << "\nExactly one of -e, -d, and -b should be specified.\n";
+	} else if (b){
+		bench(argv[optind], tableBits);
+	} else if (optind + 1 >= argc){
+		printHelpMsg();
+	} else if (e){
+		encode(argv[optind], argv[optind + 1], tableBits);
+	} else{
+		decode(argv[optind], argv[optind + 1]);
+	}
+
+	return 0;
+}
+
+void printHelpMsg(){
+	std::cout << "Usage: mix_sample <input file> <output file> -opts\n";
+	std::cout << "       mix_sample <input file> -b\n";
+	std::cout << "Options:";
+	std::cout << "\n	-e	encode";
+	std::cout << "\n	-d	decode";
+	std::cout << "\n	-b	benchmark against the other engines";
+	std::cout << "\n	-m B	use context mixing tables of 2 ^ B buckets (" << MIX_MIN_BITS << " to " << MIX_MAX_BITS << ", default " << MIX_DEFAULT_BITS << ")";
+	std::cout << "\nExactly one of -e, -d, and -b should be specified.\n";
+}
+
+int encode(std::string inputFile, std::string outputFile, int tableBits){
+	std::ifstream ifs(inputFile.c_str());
+	std::ofstream ofs(outputFile.c_str());
+
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	if (!ofs.good()){
+		std::cout << "Error opening file for output.\n";
+		return 1;
+	}
+
+	putHeader(ofs);
+
+	// USAGE OF LIBRARY
+	ArFrameWriter afw(&ofs);
+	afw.putStreamHeader();
+
+	char* block = new char[blockSize];
+	int i = 0;
+	while (ifs.read(block, blockSize) || ifs.gcount() > 0){
+		i += ifs.gcount();
+		afw.putMixFrame((uint8_t*) block, ifs.gcount(), tableBits);
+	}
+	delete[] block;
+
+	afw.finish();
+	// END USAGE OF LIBRARY
+
+	std::cout << "Encoded " << i << " characters.\n";
+
+	return 0;
+}
+
+int decode(std::string inputFile, std::string outputFile){
+	std::ifstream ifs(inputFile.c_str());
+	std::ofstream ofs(outputFile.c_str());
+
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	if (!ofs.good()){
+		std::cout << "Error opening file for output.\n";
+		return 1;
+	}
+
+	if (!checkHeader(ifs)){
+		std::cout << "The header does not match. Please verify that this file is in the correct format.\n";
+		return 1;
+	}
+
+	// USAGE OF LIBRARY
+	ArFrameReader afr(&ifs);
+	if (!afr.readStreamHeader()){
+		std::cout << "Unsupported stream version.\n";
+		return 1;
+	}
+
+	int i = 0;
+	ArFrameHeader fh;
+	std::string payload;
+	std::string block;
+	while (afr.next(&fh)){
+		afr.readPayload(fh, &payload);
+		block.resize(fh.symbols);
+		if (!ArFrameReader::decodeFrame(NULL, fh, payload, (uint8_t*) &block[0])){
+			std::cout << "Corrupt or unknown frame.\n";
+			return 1;
+		}
+		ofs.write(block.data(), block.size());
+		i += fh.symbols;
+	}
+	// END USAGE OF LIBRARY
+
+	std::cout << "Decoded " << i << " characters.\n";
+
+	return 0;
+}
+
+/*
+ * Codes the whole file with each engine, in frames of blockSize, and
+ * reports the size and speed of each.
+ */
+int bench(std::string inputFile, int tableBits){
+	std::ifstream ifs(inputFile.c_str());
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	std::cout << "Input: " << data.size() << " bytes\n";
+	std::cout << "Engine		Size		Bits/byte	Encode MB/s	Decode MB/s\n";
+
+	benchFrames(data, ENGINE_ADAPTIVE, tableBits, "order-0");
+	benchFrames(data, ENGINE_LZ77, tableBits, "lz77");
+	benchFrames(data, ENGINE_BWT, tableBits, "bwt");
+	benchFrames(data, ENGINE_MIX, tableBits, "mix");
+
+	return 0;
+}
+
+void benchFrames(const std::string& data, uint8_t engine, int tableBits, const char* name){
+	std::stringstream ss;
+	ArFrameWriter afw(&ss);
+
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < data.size(); i += blockSize){
+		uint32_t count = data.size() - i < (size_t) blockSize ? data.size() - i : blockSize;
+		const uint8_t* src = (const uint8_t*) data.data() + i;
+		if (engine == ENGINE_ADAPTIVE){
+			afw.putAdaptiveFrame(src, count);
+		} else if (engine == ENGINE_LZ77){
+			afw.putLzFrame(src, count, LZ_DEFAULT_LEVEL);
+		} else if (engine == ENGINE_BWT){
+			afw.putBwtFrame(src, count);
+		} else{
+			afw.putMixFrame(src, count, tableBits);
+		}
+	}
+	afw.finish();
+	std::chrono::high_resolution_clock::time_point middle = std::chrono::high_resolution_clock::now();
+
+	std::string decoded(data.size(), 0);
+	ArFrameReader afr(&ss);
+	ArFrameHeader fh;
+	std::string payload;
+	bool ok = true;
+	size_t pos = 0;
+	while (afr.next(&fh)){
+		afr.readPayload(fh, &payload);
+		ok = ok && ArFrameReader::decodeFrame(NULL, fh, payload, (uint8_t*) &decoded[pos]);
+		pos += fh.symbols;
+	}
+	ok = ok && decoded == data;
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	double mb = data.size() / 1e6;
+	std::cout << name << "\t\t" << ss.str().size() << "\t\t" << 8.0 * ss.str().size() / data.size();
+	std::cout << "\t\t" << mb / std::chrono::duration<double>(middle - begin).count();
+	std::cout << "\t\t" << mb / std::chrono::duration<double>(end - middle).count();
+	std::cout << (ok ? "" : "\tINCORRECT") << "\n";
+}
+
+void putHeader(std::ofstream& ofs){
+	ofs.write(header.c_str(), header.length());
+}
+
+int checkHeader(std::istream& ifs){
+	char* buf = new char[header.length() + 1];
+	ifs.read(buf, header.length());
+	buf[header.length()] = '\0'; // Null terminate
+
+	int ret = (header == std::string(buf));
+	delete[] buf;
+	return ret;
+}
@@ -1,8 +1,12 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iterator>
+#include <chrono>
 #include <unistd.h>
 
 #include "Model.h"
+#include "ShiftModel.h"
 #include "ArEncoder.h"
 #include "ArDecoder.h"
 
@@ -11,21 +15,24 @@ int checkHeader(std::istream& ifs);
 void putHeader(std::ofstream& ofs);
 int decode(std::string inputFile, std::string outputFile);
 int encode(std::string inputFile, std::string outputFile);
+int bench(std::string inputFile);
+template <class M> void benchModel(const std::string& data, M* m, const char* name);
 
 const std::string header = "perfect_sample";
 
 int main(int argc, char** argv){
-	if (argc < 4){
+	if (argc < 3){
 		printHelpMsg();
 		return 0;
 	}
 
 	int e = 0;
 	int d = 0;
+	int b = 0;
 
 	int opt;
 	opterr = 0;
-	while ((opt = getopt(argc, argv, "edh")) != -1){
+	while ((opt = getopt(argc, argv, "edbh")) != -1){
 		switch(opt){
 			case 'e':
 				e = 1;
@@ -33,6 +40,9 @@ int main(int argc, char** argv){
 			case 'd':
 				d = 1;
 				break;
+			case 'b':
+				b = 1;
+				break;
 			case 'h':
 				printHelpMsg();
 				return 0;
@@ -47,6 +57,15 @@ int main(int argc, char** argv){
 		}
 	}
 
+	if (b){
+		return bench(argv[optind]);
+	}
+
+	if (argc < 4){
+		printHelpMsg();
+		return 0;
+	}
+
 	if (e && d){
 		std::cout << "\nOnly one of -e and -d may be specified.\n";
 	} else if (e){
@@ -62,9 +81,11 @@ int main(int argc, char** argv){
 
 void printHelpMsg(){
 	std::cout << "Usage: perfect_sample <input file> <output file> -opts\n";
+	std::cout << "       perfect_sample <input file> -b\n";
 	std::cout << "Options:";
 	std::cout << "\n	-e	encode";
 	std::cout << "\n	-d	decode";
+	std::cout << "\n	-b	compare the exact counts with power of two ShiftModels, in ratio and speed";
 	std::cout << "\nExactly one of -d and -e should be specified.\n";
 }
 
@@ -160,6 +181,86 @@ int decode(std::string inputFile, std::string outputFile){
 	return 0;
 }
 
+/*
+ * Codes the whole file with its exact counts, and then with those
+ * counts scaled to each power of two a ShiftModel allows, and reports
+ * the size and speed of each. Unlike encode(), the counts are not taken
+ * away as characters are coded, so every model stays static.
+ */
+int bench(std::string inputFile){
+	std::ifstream ifs(inputFile.c_str());
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	// USAGE OF LIBRARY
+	Model m;
+	m.ingest((const uint8_t*) data.data(), data.size());
+	// END USAGE OF LIBRARY
+
+	std::cout << "Input: " << data.size() << " bytes, order-0 entropy " << m.getEntropy() << " bits/byte\n";
+	std::cout << "Model		Size		Bits/byte	Encode MB/s	Decode MB/s\n";
+
+	benchModel(data, &m, "exact");
+	for (int bits = SHIFT_MIN_BITS; bits <= SHIFT_MAX_BITS; bits++){
+		// USAGE OF LIBRARY
+		ShiftModel sm;
+		sm.build(&m, bits);
+		// END USAGE OF LIBRARY
+
+		std::string name = "2^" + std::to_string(bits);
+		benchModel(data, &sm, name.c_str());
+	}
+
+	return 0;
+}
+
+// The calls that code a buffer with each kind of model
+static inline void putAll(ArEncoder* are, Model* m, const std::string& data){
+	are->setModel(m);
+	are->put((const uint8_t*) data.data(), data.size());
+}
+
+static inline void putAll(ArEncoder* are, ShiftModel* sm, const std::string& data){
+	are->put(sm, (const uint8_t*) data.data(), data.size());
+}
+
+static inline void getAll(ArDecoder* ard, Model* m, std::string* dst){
+	ard->setModel(m);
+	ard->get((uint8_t*) &(*dst)[0], dst->size());
+}
+
+static inline void getAll(ArDecoder* ard, ShiftModel* sm, std::string* dst){
+	ard->get(sm, (uint8_t*) &(*dst)[0], dst->size());
+}
+
+template <class M> void benchModel(const std::string& data, M* m, const char* name){
+	std::stringstream ss;
+	std::string decoded(data.size(), 0);
+
+	std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+	// USAGE OF LIBRARY
+	ArEncoder are(NULL, &ss);
+	putAll(&are, m, data);
+	are.finish();
+	// END USAGE OF LIBRARY
+	std::chrono::high_resolution_clock::time_point middle = std::chrono::high_resolution_clock::now();
+	// USAGE OF LIBRARY
+	ArDecoder ard(NULL, &ss);
+	getAll(&ard, m, &decoded);
+	// END USAGE OF LIBRARY
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+	double mb = data.size() / 1e6;
+	std::cout << name << "\t\t" << ss.str().size() << "\t\t" << 8.0 * ss.str().size() / data.size();
+	std::cout << "\t\t" << mb / std::chrono::duration<double>(middle - begin).count();
+	std::cout << "\t\t" << mb / std::chrono::duration<double>(end - middle).count();
+	std::cout << (decoded == data ? "" : "\tINCORRECT") << "\n";
+}
+
 void putHeader(std::ofstream& ofs){
 	ofs.write(header.c_str(), header.length());
 }
@@ -0,0 +1,200 @@
+#include <iostream>
+#include <fstream>
+#include <unistd.h>
+
+#include "Model.h"
+#include "ArPushEncoder.h"
+#include "ArPushDecoder.h"
+
+void printHelpMsg();
+int checkHeader(std::istream& ifs);
+void putHeader(std::ofstream& ofs);
+int decode(std::string inputFile, std::string outputFile);
+int encode(std::string inputFile, std::string outputFile);
+
+const std::string header = "push_sample";
+
+// Small buffers, to show the coders suspending and resuming
+const int chunkSize = 100;
+const int outputSize = 512;
+
+int main(int argc, char** argv){
+	if (argc < 4){
+		printHelpMsg();
+		return 0;
+	}
+
+	int e = 0;
+	int d = 0;
+
+	int opt;
+	opterr = 0;
+	while ((opt = getopt(argc, argv, "edh")) != -1){
+		switch(opt){
+			case 'e':
+				e = 1;
+				break;
+			case 'd':
+				d = 1;
+				break;
+			case 'h':
+				printHelpMsg();
+				return 0;
+			case '?':
+				std::cout << "Unknown options '-" << optopt << "'.\n";
+				printHelpMsg();
+				return 1;
+			default:
+				std::cout << "An unknown error occurred\n";
+				printHelpMsg();
+				return 1;
+		}
+	}
+
+	if (e && d){
+		std::cout << "\nOnly one of -e and -d may be specified.\n";
+	} else if (e){
+		encode(argv[optind], argv[optind + 1]);
+	} else if (d){
+		decode(argv[optind], argv[optind + 1]);
+	} else{
+		std::cout << "\nExactly one of -d and -e should be specified.\n";
+	}
+
+	return 0;
+}
+
+void printHelpMsg(){
+	std::cout << "Usage: push_sample <input file> <output file> -opts\n";
+	std::cout << "Options:";
+	std::cout << "\n	-e	encode";
+	std::cout << "\n	-d	decode";
+	std::cout << "\nExactly one of -d and -e should be specified.\n";
+}
+
+int encode(std::string inputFile, std::string outputFile){
+	std::ifstream ifs(inputFile.c_str());
+	std::ofstream ofs(outputFile.c_str());
+
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	if (!ofs.good()){
+		std::cout << "Error opening file for output.\n";
+		return 1;
+	}
+
+	putHeader(ofs);
+
+	// The character count lets the decoder know when to stop
+	ifs.seekg(0, ifs.end);
+	uint32_t total = ifs.tellg();
+	ifs.seekg(0, ifs.beg);
+	ofs.write((char*) &total, sizeof(total));
+
+	// USAGE OF LIBRARY
+	Model m;
+	ArPushEncoder are(&m);
+	uint8_t outbuf[outputSize];
+	are.setOutput(outbuf, sizeof(outbuf));
+
+	// Initialize m with every character having a slot
+	for (int i = 0; i < 256; i++){
+		m.update(i);
+	}
+
+	int i = 0;
+	char c = ifs.get();
+	while (ifs.good()){
+		// When the output buffer is full, send it and try again
+		if (!are.put(c)){
+			ofs.write((char*) outbuf, are.produced());
+			are.setOutput(outbuf, sizeof(outbuf));
+			continue;
+		}
+		i++;
+		m.update(c);
+		c = ifs.get();
+	}
+
+	while (!are.finish()){
+		ofs.write((char*) outbuf, are.produced());
+		are.setOutput(outbuf, sizeof(outbuf));
+	}
+	ofs.write((char*) outbuf, are.produced());
+
+	// END USAGE OF LIBRARY
+
+	std::cout << "Encoded " << i << " characters.\n";
+
+	return 0;
+}
+
+int decode(std::string inputFile, std::string outputFile){
+	std::ifstream ifs(inputFile.c_str());
+	std::ofstream ofs(outputFile.c_str());
+
+	if (!ifs.good()){
+		std::cout << "Error opening file for input.\n";
+		return 1;
+	}
+
+	if (!ofs.good()){
+		std::cout << "Error opening file for output.\n";
+		return 1;
+	}
+
+	if (!checkHeader(ifs)){
+		std::cout << "The header does not match. Please verify that this file is in the correct format.\n";
+		return 1;
+	}
+
+	uint32_t total;
+	ifs.read((char*) &total, sizeof(total));
+
+	// USAGE OF LIBRARY
+	Model m;
+	ArPushDecoder ard(&m);
+
+	// Initialize m with every character having a slot
+	for (int i = 0; i < 256; i++){
+		m.update(i);
+	}
+
+	// Input arrives in small chunks, as it would from a socket
+	char chunk[chunkSize];
+	uint32_t i = 0;
+	uint8_t c;
+	while (i < total){
+		if (ard.get(&c)){
+			i++;
+			m.update(c);
+			ofs.put(c);
+		} else if (ifs.read(chunk, sizeof(chunk)) || ifs.gcount() > 0){
+			ard.feed((uint8_t*) chunk, ifs.gcount());
+		} else{
+			ard.finish();
+		}
+	}
+	// END USAGE OF LIBRARY
+
+	std::cout << "Decoded " << i << " characters.\n";
+
+	return 0;
+}
+
+void putHeader(std::ofstream& ofs){
+	ofs.write(header.c_str(), header.length());
+}
+
+int checkHeader(std::istream& ifs){
+	char* buf = new char[header.length() + 1];
+	ifs.read(buf, header.length());
+	buf[header.length()] = '\0'; // Null terminate
+
+	int ret = (header == std::string(buf));
+	delete[] buf;
+	return ret;
+}
@@ -0,0 +1,446 @@
+#include "ArBatch.h"
+#include "Model.h"
+#include "Kernels.h"
+
+#include <string.h>
+#include <immintrin.h>
+
+/*
+ * Each lane's state stays in [BATCH_LOW, 2 ^ 31) between characters and
+ * is renormalized 16 bits at a time. Keeping it under 2 ^ 31 is what
+ * makes the reciprocal division below exact.
+ */
+static const uint32_t BATCH_LOW = (uint32_t) 0x1 << 15;
+static const uint32_t BATCH_MASK = ((uint32_t) 0x1 << BATCH_SCALE_BITS) - 1;
+
+// Fields of ArBatch::info
+static const uint32_t INFO_FREQ = 0x1FFF;
+static const int INFO_BIAS = 13;
+static const int INFO_SHIFT = 26;
+
+static inline void put16(uint8_t* p, uint32_t w){
+	p[0] = w;
+	p[1] = w >> 8;
+}
+
+static inline uint32_t get16(const uint8_t* p){
+	return p[0] | (uint32_t) p[1] << 8;
+}
+
+static inline void put32(uint8_t* p, uint32_t w){
+	put16(p, w);
+	put16(p + 2, w >> 16);
+}
+
+static inline uint32_t get32(const uint8_t* p){
+	return get16(p) | get16(p + 2) << 16;
+}
+
+/*
+ * Builds the coding tables from m. If m is NULL or empty, the coder
+ * is not good() and refuses to code anything.
+ */
+ArBatch::ArBatch(Model* m){
+	ready = m != NULL && m->normalize(freq, BATCH_SCALE_BITS);
+	simd = getKernels()->level >= CPU_AVX2;
+
+	if (!ready){
+		memset(freq, 0, sizeof(freq));
+	}
+
+	uint32_t start = 0;
+	for (int c = 0; c < 256; c++){
+		uint32_t f = freq[c];
+
+		// Division by f is done as a multiply by a 32 bit reciprocal and a
+		// shift. A frequency of 1 has no such reciprocal, so it divides by
+		// ~0 instead, which is off by one that the bias makes up.
+		if (f < 2){
+			rcp[c] = ~0;
+			info[c] = f | (start + BATCH_MASK) << INFO_BIAS;
+		} else {
+			uint32_t s = 0;
+			while (f > ((uint32_t) 0x1 << s)){
+				s++;
+			}
+			rcp[c] = (((uint64_t) 0x1 << (s + 31)) + f - 1) / f;
+			info[c] = f | start << INFO_BIAS | (s - 1) << INFO_SHIFT;
+		}
+
+		for (uint32_t i = 0; i < f; i++){
+			slots[start + i] = i | c << BATCH_SCALE_BITS | (f - 1) << (BATCH_SCALE_BITS + 8);
+		}
+		start += f;
+	}
+}
+
+ArBatch::~ArBatch(){}
+
+/*
+ * False if the Model given at construction was NULL or empty.
+ */
+bool ArBatch::good(){
+	return ready;
+}
+
+/*
+ * Turns the AVX2 lanes on or off. They are on by default when the
+ * kernels chosen at startup are AVX2 or better, and cannot be turned on
+ * otherwise. The output is the same either way.
+ */
+void ArBatch::setSimd(bool enable){
+	simd = enable && getKernels()->level >= CPU_AVX2;
+}
+
+bool ArBatch::usesSimd(){
+	return simd;
+}
+
+/*
+ * The most bytes that encoding count characters can produce: the final
+ * state, and at most one 16 bit word per character.
+ */
+uint32_t ArBatch::bound(uint32_t count){
+	return 4 + 2 * count;
+}
+
+/*
+ * Encodes n messages. Message i is the counts[i] characters at src[i],
+ * and is written to dst[i], which has room for caps[i] bytes. The size
+ * of each encoded message is stored in written[i].
+ *
+ * Every cap must be at least bound(counts[i]), since the lanes write
+ * their output back to front before moving it into place.
+ *
+ * Returns false if the coder is not good(), a cap is too small, or a
+ * message contains a character the Model has never seen.
+ */
+bool ArBatch::encode(int n, const uint8_t* const* src, const uint32_t* counts,
+		uint8_t* const* dst, const uint32_t* caps, uint32_t* written){
+	if (!ready){
+		return false;
+	}
+	for (int i = 0; i < n; i++){
+		if (caps[i] < bound(counts[i])){
+			return false;
+		}
+	}
+
+	if (simd && n >= BATCH_LANES){
+		return encodeLanes(n, src, counts, dst, written);
+	}
+
+	for (int i = 0; i < n; i++){
+		uint8_t* end = dst[i] + bound(counts[i]);
+		if (!encodeRest(src[i], src[i] + counts[i], BATCH_LOW, end, dst[i], counts[i], written + i)){
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Decodes n messages. Message i is the lengths[i] bytes at src[i], and
+ * decodes to counts[i] characters written to dst[i].
+ *
+ * Returns false if the coder is not good() or a message ends early.
+ * Messages that were not produced by encode() with the same Model decode
+ * to garbage.
+ */
+bool ArBatch::decode(int n, const uint8_t* const* src, const uint32_t* lengths,
+		uint8_t* const* dst, const uint32_t* counts){
+	if (!ready){
+		return false;
+	}
+
+	if (simd && n >= BATCH_LANES){
+		return decodeLanes(n, src, lengths, dst, counts);
+	}
+
+	bool ok = true;
+	for (int i = 0; i < n; i++){
+		if (lengths[i] < 4){
+			ok = false;
+			continue;
+		}
+		ok &= decodeRest(src[i] + 4, src[i] + lengths[i], get32(src[i]), dst[i], counts[i]);
+	}
+
+	return ok;
+}
+
+/*
+ * Encodes the characters from begin up to in, last to first, starting
+ * from state x and writing back to front from p. Then writes the state
+ * and moves the message, which encodes count characters in all, to dst.
+ */
+bool ArBatch::encodeRest(const uint8_t* begin, const uint8_t* in, uint32_t x, uint8_t* p,
+		uint8_t* dst, uint32_t count, uint32_t* written){
+	while (in > begin){
+		uint8_t c = *--in;
+		uint32_t f = info[c] & INFO_FREQ;
+		if (f == 0){
+			return false;
+		}
+		if (x >= f << (31 - BATCH_SCALE_BITS)){
+			p -= 2;
+			put16(p, x);
+			x >>= 16;
+		}
+		uint32_t q = (uint32_t) (((uint64_t) x * rcp[c]) >> 32) >> (info[c] >> INFO_SHIFT);
+		x += (info[c] >> INFO_BIAS & (BATCH_MASK * 2 + 1)) + q * (BATCH_MASK + 1 - f);
+	}
+	p -= 4;
+	put32(p, x);
+
+	*written = dst + bound(count) - p;
+	memmove(dst, p, *written);
+	return true;
+}
+
+/*
+ * Decodes left characters to out, starting from state x and reading
+ * from in up to end.
+ */
+bool ArBatch::decodeRest(const uint8_t* in, const uint8_t* end, uint32_t x, uint8_t* out, uint32_t left){
+	bool ok = true;
+	while (left-- > 0){
+		uint32_t slot = slots[x & BATCH_MASK];
+		*out++ = slot >> BATCH_SCALE_BITS;
+		x = ((slot >> (BATCH_SCALE_BITS + 8)) + 1) * (x >> BATCH_SCALE_BITS) + (slot & BATCH_MASK);
+		if (x < BATCH_LOW){
+			if (in + 2 <= end){
+				x = x << 16 | get16(in);
+				in += 2;
+			} else {
+				x = x << 16;
+				ok = false;
+			}
+		}
+	}
+
+	return ok;
+}
+
+/*
+ * Encodes n messages on BATCH_LANES lanes. A lane that finishes its
+ * message moves on to the next one, so that messages of different
+ * lengths still keep every lane busy. Once there are no messages left
+ * to hand out, the lanes still running finish one at a time.
+ *
+ * The lanes are split across two registers, so that one can go on
+ * while the other waits for its gathers.
+ */
+__attribute__((target("avx2")))
+bool ArBatch::encodeLanes(int n, const uint8_t* const* src, const uint32_t* counts, uint8_t* const* dst, uint32_t* written){
+	const uint8_t* begin[BATCH_LANES];
+	const uint8_t* in[BATCH_LANES];
+	uint8_t* out[BATCH_LANES];
+	int msg[BATCH_LANES];
+	alignas(32) uint32_t lane[BATCH_LANES];
+
+	const __m256i freqMask = _mm256_set1_epi32(INFO_FREQ);
+	const __m256i biasMask = _mm256_set1_epi32(BATCH_MASK * 2 + 1);
+	const __m256i total = _mm256_set1_epi32(BATCH_MASK + 1);
+	const __m256i zero = _mm256_setzero_si256();
+
+	int next = 0;
+	for (int j = 0; j < BATCH_LANES; j++){
+		msg[j] = -1;
+	}
+
+	while (true){
+		bool full = true;
+		for (int j = 0; j < BATCH_LANES; j++){
+			if (msg[j] >= 0 && in[j] == begin[j]){
+				encodeRest(begin[j], in[j], lane[j], out[j], dst[msg[j]], counts[msg[j]], written + msg[j]);
+				msg[j] = -1;
+			}
+			for (; msg[j] < 0 && next < n; next++){
+				begin[j] = src[next];
+				in[j] = src[next] + counts[next];
+				out[j] = dst[next] + bound(counts[next]);
+				lane[j] = BATCH_LOW;
+				if (counts[next] > 0){
+					msg[j] = next;
+				} else {
+					encodeRest(begin[j], in[j], lane[j], out[j], dst[next], 0, written + next);
+				}
+			}
+			full = full && msg[j] >= 0;
+		}
+		if (!full){
+			break;
+		}
+
+		ptrdiff_t run = in[0] - begin[0];
+		for (int j = 1; j < BATCH_LANES; j++){
+			if (in[j] - begin[j] < run){
+				run = in[j] - begin[j];
+			}
+		}
+
+		__m256i x[2], missing = zero;
+		x[0] = _mm256_load_si256((const __m256i*) lane);
+		x[1] = _mm256_load_si256((const __m256i*) (lane + 8));
+		for (ptrdiff_t r = 1; r <= run; r++){
+			uint32_t emit = 0;
+			for (int h = 0; h < 2; h++){
+				const uint8_t* const* p = in + 8 * h;
+				__m256i c = _mm256_setr_epi32(p[0][-r], p[1][-r], p[2][-r], p[3][-r],
+					p[4][-r], p[5][-r], p[6][-r], p[7][-r]);
+				__m256i packed = _mm256_i32gather_epi32((const int*) info, c, 4);
+				__m256i rc = _mm256_i32gather_epi32((const int*) rcp, c, 4);
+				__m256i f = _mm256_and_si256(packed, freqMask);
+				missing = _mm256_or_si256(missing, _mm256_cmpeq_epi32(f, zero));
+
+				// Renormalize the lanes whose state would overflow
+				__m256i limit = _mm256_slli_epi32(f, 31 - BATCH_SCALE_BITS);
+				__m256i over = _mm256_cmpeq_epi32(_mm256_max_epu32(x[h], limit), x[h]);
+				emit |= _mm256_movemask_ps(_mm256_castsi256_ps(over)) << 8 * h;
+				_mm256_store_si256((__m256i*) (lane + 8 * h), x[h]);
+				x[h] = _mm256_blendv_epi8(x[h], _mm256_srli_epi32(x[h], 16), over);
+
+				// q = x / f, through the reciprocal; then x = q * total + x % f + start
+				__m256i even = _mm256_srli_epi64(_mm256_mul_epu32(x[h], rc), 32);
+				__m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(x[h], 32), _mm256_srli_epi64(rc, 32));
+				__m256i q = _mm256_srlv_epi32(_mm256_blend_epi32(even, odd, 0xAA), _mm256_srli_epi32(packed, INFO_SHIFT));
+				__m256i bias = _mm256_and_si256(_mm256_srli_epi32(packed, INFO_BIAS), biasMask);
+				x[h] = _mm256_add_epi32(_mm256_add_epi32(x[h], bias), _mm256_mullo_epi32(q, _mm256_sub_epi32(total, f)));
+			}
+
+			for (; emit; emit &= emit - 1){
+				int j = __builtin_ctz(emit);
+				out[j] -= 2;
+				put16(out[j], lane[j]);
+			}
+		}
+		_mm256_store_si256((__m256i*) lane, x[0]);
+		_mm256_store_si256((__m256i*) (lane + 8), x[1]);
+		for (int j = 0; j < BATCH_LANES; j++){
+			in[j] -= run;
+		}
+
+		if (!_mm256_testz_si256(missing, missing)){
+			return false;
+		}
+	}
+
+	bool ok = true;
+	for (int j = 0; j < BATCH_LANES; j++){
+		if (msg[j] >= 0){
+			ok &= encodeRest(begin[j], in[j], lane[j], out[j], dst[msg[j]], counts[msg[j]], written + msg[j]);
+		}
+	}
+
+	return ok;
+}
+
+/*
+ * Decodes n messages on BATCH_LANES lanes, handing out messages the same
+ * way as encodeLanes().
+ */
+__attribute__((target("avx2")))
+bool ArBatch::decodeLanes(int n, const uint8_t* const* src, const uint32_t* lengths, uint8_t* const* dst, const uint32_t* counts){
+	const uint8_t* in[BATCH_LANES];
+	const uint8_t* end[BATCH_LANES];
+	uint8_t* out[BATCH_LANES];
+	uint32_t left[BATCH_LANES];
+	alignas(32) uint32_t lane[BATCH_LANES];
+	uint32_t words[BATCH_LANES];
+
+	const __m256i slotMask = _mm256_set1_epi32(BATCH_MASK);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i low = _mm256_set1_epi32(BATCH_LOW);
+
+	bool ok = true;
+	int next = 0;
+	for (int j = 0; j < BATCH_LANES; j++){
+		left[j] = 0;
+		words[j] = 0;
+	}
+
+	while (true){
+		bool full = true;
+		for (int j = 0; j < BATCH_LANES; j++){
+			for (; left[j] == 0 && next < n; next++){
+				if (lengths[next] < 4){
+					ok = false;
+					continue;
+				}
+				in[j] = src[next] + 4;
+				end[j] = src[next] + lengths[next];
+				out[j] = dst[next];
+				left[j] = counts[next];
+				lane[j] = get32(src[next]);
+			}
+			full = full && left[j] > 0;
+		}
+		if (!full){
+			break;
+		}
+
+		uint32_t run = left[0];
+		for (int j = 1; j < BATCH_LANES; j++){
+			if (left[j] < run){
+				run = left[j];
+			}
+		}
+
+		__m256i x[2], under[2];
+		x[0] = _mm256_load_si256((const __m256i*) lane);
+		x[1] = _mm256_load_si256((const __m256i*) (lane + 8));
+		for (uint32_t r = 0; r < run; r++){
+			uint32_t take = 0;
+			for (int h = 0; h < 2; h++){
+				__m256i slot = _mm256_i32gather_epi32((const int*) slots, _mm256_and_si256(x[h], slotMask), 4);
+				__m256i f = _mm256_add_epi32(_mm256_srli_epi32(slot, BATCH_SCALE_BITS + 8), one);
+				x[h] = _mm256_mullo_epi32(f, _mm256_srli_epi32(x[h], BATCH_SCALE_BITS));
+				x[h] = _mm256_add_epi32(x[h], _mm256_and_si256(slot, slotMask));
+				_mm256_store_si256((__m256i*) (lane + 8 * h), slot);
+
+				// States are under 2 ^ 31, so a signed compare will do
+				under[h] = _mm256_cmpgt_epi32(low, x[h]);
+				take |= _mm256_movemask_ps(_mm256_castsi256_ps(under[h])) << 8 * h;
+			}
+
+			for (int j = 0; j < BATCH_LANES; j++){
+				out[j][r] = lane[j] >> BATCH_SCALE_BITS;
+			}
+
+			// Only the lanes that renormalize read a word; the others
+			// ignore what is in words
+			for (; take; take &= take - 1){
+				int j = __builtin_ctz(take);
+				if (in[j] + 2 <= end[j]){
+					words[j] = get16(in[j]);
+					in[j] += 2;
+				} else {
+					words[j] = 0;
+					ok = false;
+				}
+			}
+			for (int h = 0; h < 2; h++){
+				const uint32_t* p = words + 8 * h;
+				__m256i w = _mm256_setr_epi32(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7]);
+				x[h] = _mm256_blendv_epi8(x[h], _mm256_or_si256(_mm256_slli_epi32(x[h], 16), w), under[h]);
+			}
+		}
+		_mm256_store_si256((__m256i*) lane, x[0]);
+		_mm256_store_si256((__m256i*) (lane + 8), x[1]);
+
+		for (int j = 0; j < BATCH_LANES; j++){
+			out[j] += run;
+			left[j] -= run;
+		}
+	}
+
+	for (int j = 0; j < BATCH_LANES; j++){
+		if (left[j] > 0){
+			ok &= decodeRest(in[j], end[j], lane[j], out[j], left[j]);
+		}
+	}
+
+	return ok;
+}
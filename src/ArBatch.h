@@ -0,0 +1,58 @@
+#ifndef ARBATCH_INCLUDED
+#define ARBATCH_INCLUDED
+
+#include <stdint.h>
+
+class Model;
+
+const int BATCH_LANES = 16;			// Messages coded side by side, one per lane
+const int BATCH_SCALE_BITS = 12;	// The shared Model is scaled to a total of 2 ^ BATCH_SCALE_BITS
+
+/*
+ * Codes many independent messages against one shared Model at once,
+ * with one coder per message running in lockstep in SIMD registers.
+ * It is meant for lots of small messages (records, packets), where a
+ * single coder spends most of its time waiting on its own state.
+ *
+ * The lanes are range ANS coders over the Model scaled to a power of two
+ * total, so the output is not compatible with ArEncoder's. Each message
+ * is coded on its own and the output does not depend on which messages
+ * are batched together, or on whether AVX2 is available; without it
+ * the same lanes are run one after another.
+ */
+class ArBatch{
+public:
+	ArBatch(Model* m);
+	~ArBatch();
+
+	bool good();
+	void setSimd(bool enable);
+	bool usesSimd();
+
+	static uint32_t bound(uint32_t count);
+	bool encode(int n, const uint8_t* const* src, const uint32_t* counts,
+		uint8_t* const* dst, const uint32_t* caps, uint32_t* written);
+	bool decode(int n, const uint8_t* const* src, const uint32_t* lengths,
+		uint8_t* const* dst, const uint32_t* counts);
+private:
+	bool ready;
+	bool simd;
+
+	// Per character, for encoding: the frequency, the bias (the start of
+	// its range) and the reciprocal's shift packed in info, and the
+	// reciprocal of the frequency in rcp
+	uint32_t freq[256];
+	uint32_t info[256];
+	uint32_t rcp[256];
+
+	// Per slot, for decoding: offset into the character's range, the
+	// character, and its frequency less one
+	uint32_t slots[1 << BATCH_SCALE_BITS];
+
+	bool encodeRest(const uint8_t* begin, const uint8_t* in, uint32_t x, uint8_t* p, uint8_t* dst, uint32_t count, uint32_t* written);
+	bool decodeRest(const uint8_t* in, const uint8_t* end, uint32_t x, uint8_t* out, uint32_t left);
+	bool encodeLanes(int n, const uint8_t* const* src, const uint32_t* counts, uint8_t* const* dst, uint32_t* written);
+	bool decodeLanes(int n, const uint8_t* const* src, const uint32_t* lengths, uint8_t* const* dst, const uint32_t* counts);
+};
+
+#endif
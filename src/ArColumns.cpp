@@ -0,0 +1,302 @@
+#include "ArColumns.h"
+#include "ArEncoder.h"
+#include "ArDecoder.h"
+#include "Model.h"
+#include "Int.h"
+
+const char COLUMNS_MAGIC[4] = {'A', 'r', 'C', 'c'};
+
+ArColumnWriter::ArColumnWriter(std::ostream* outstream){
+	out = outstream;
+	finished = false;
+}
+
+ArColumnWriter::~ArColumnWriter(){
+	for (size_t i = 0; i < columns.size(); i++){
+		delete columns[i]->are;
+		delete columns[i]->ie;
+		delete columns[i]->model;
+		delete columns[i];
+	}
+}
+
+/*
+ * Adds a column of characters.
+ * Returns its number, or -1 if the container has already been finished
+ * or holds COLUMNS_MAX columns.
+ */
+int ArColumnWriter::addByteColumn(){
+	if (finished || columns.size() >= COLUMNS_MAX){
+		return -1;
+	}
+
+	Column* c = new Column();
+	c->info.kind = COLUMN_BYTES;
+	c->info.transform = INT_RAW;
+	c->model = new Model();
+	c->model->flatten();
+	c->are = new ArEncoder(c->model, &c->data);
+	c->ie = NULL;
+
+	columns.push_back(c);
+	return columns.size() - 1;
+}
+
+/*
+ * Adds a column of int64_t values, coded with the given IntEncoder
+ * transform.
+ * Returns its number, or -1 if the container has already been finished
+ * or holds COLUMNS_MAX columns.
+ */
+int ArColumnWriter::addIntColumn(int transform){
+	if (finished || columns.size() >= COLUMNS_MAX){
+		return -1;
+	}
+
+	Column* c = new Column();
+	c->info.kind = COLUMN_INTS;
+	c->model = NULL;
+	c->are = NULL;
+	c->ie = new IntEncoder(&c->data, transform);
+	c->info.transform = transform == INT_DELTA || transform == INT_DELTA2 ? transform : INT_RAW;
+
+	columns.push_back(c);
+	return columns.size() - 1;
+}
+
+bool ArColumnWriter::putByte(int col, uint8_t c){
+	return putBytes(col, &c, 1);
+}
+
+/*
+ * Codes count characters into a byte column.
+ * Returns false if col is not a byte column or the container is finished.
+ */
+bool ArColumnWriter::putBytes(int col, const uint8_t* src, size_t count){
+	Column* c = getColumn(col, COLUMN_BYTES);
+	if (c == NULL){
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++){
+		c->are->put(src[i]);
+		c->model->adapt(src[i]);
+	}
+	c->info.symbols += count;
+
+	return true;
+}
+
+bool ArColumnWriter::putInt(int col, int64_t v){
+	return putInts(col, &v, 1);
+}
+
+/*
+ * Codes count values into an int column.
+ * Returns false if col is not an int column or the container is finished.
+ */
+bool ArColumnWriter::putInts(int col, const int64_t* src, size_t count){
+	Column* c = getColumn(col, COLUMN_INTS);
+	if (c == NULL){
+		return false;
+	}
+
+	c->ie->put(src, count);
+	c->info.symbols += count;
+
+	return true;
+}
+
+/*
+ * Finishes every column and writes the container. Nothing is written to
+ * out before this, since the offset table comes first.
+ *
+ * Returns false if out is NULL or not good.
+ */
+bool ArColumnWriter::finish(){
+	if (out == NULL || finished){
+		return false;
+	}
+	finished = true;
+
+	uint64_t offset = 0;
+	for (size_t i = 0; i < columns.size(); i++){
+		Column* c = columns[i];
+		if (c->are != NULL){
+			c->are->finish();
+		} else {
+			c->ie->finish();
+		}
+
+		c->info.offset = offset;
+		c->info.length = c->data.tellp();
+		offset += c->info.length;
+	}
+
+	uint32_t count = columns.size();
+	out->write(COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC));
+	out->put((char) COLUMNS_VERSION);
+	out->write((char*) &count, sizeof(count));
+
+	for (size_t i = 0; i < columns.size(); i++){
+		const ArColumnInfo& info = columns[i]->info;
+		out->put((char) info.kind);
+		out->put((char) info.transform);
+		out->write((char*) &info.symbols, sizeof(info.symbols));
+		out->write((char*) &info.offset, sizeof(info.offset));
+		out->write((char*) &info.length, sizeof(info.length));
+	}
+
+	for (size_t i = 0; i < columns.size(); i++){
+		const std::string& payload = columns[i]->data.str();
+		out->write(payload.data(), payload.size());
+	}
+
+	return out->good();
+}
+
+ArColumnWriter::Column* ArColumnWriter::getColumn(int col, uint8_t kind){
+	if (finished || col < 0 || (size_t) col >= columns.size()){
+		return NULL;
+	}
+
+	Column* c = columns[col];
+	return c->info.kind == kind ? c : NULL;
+}
+
+ArColumnReader::ArColumnReader(std::istream* instream){
+	in = instream;
+	base = 0;
+}
+
+ArColumnReader::~ArColumnReader(){}
+
+/*
+ * Reads and checks the magic and version, and reads the column table.
+ * Returns false if they do not match, the table has more than
+ * COLUMNS_MAX columns, or the stream cannot be read.
+ */
+bool ArColumnReader::readHeader(){
+	if (in == NULL){
+		return false;
+	}
+
+	char magic[sizeof(COLUMNS_MAGIC)];
+	in->read(magic, sizeof(magic));
+	uint8_t version = in->get();
+	uint32_t count = 0;
+	in->read((char*) &count, sizeof(count));
+
+	if (!in->good() || version > COLUMNS_VERSION || count > COLUMNS_MAX){
+		return false;
+	}
+	for (unsigned int i = 0; i < sizeof(COLUMNS_MAGIC); i++){
+		if (magic[i] != COLUMNS_MAGIC[i]){
+			return false;
+		}
+	}
+
+	infos.clear();
+	for (uint32_t i = 0; i < count && in->good(); i++){
+		ArColumnInfo info;
+		info.kind = in->get();
+		info.transform = in->get();
+		in->read((char*) &info.symbols, sizeof(info.symbols));
+		in->read((char*) &info.offset, sizeof(info.offset));
+		in->read((char*) &info.length, sizeof(info.length));
+		infos.push_back(info);
+	}
+	base = in->tellg();
+
+	return in->good();
+}
+
+int ArColumnReader::getColumnCount(){
+	return infos.size();
+}
+
+/*
+ * The table entry for a column, or NULL if there is no such column.
+ */
+const ArColumnInfo* ArColumnReader::getInfo(int col){
+	if (col < 0 || (size_t) col >= infos.size()){
+		return NULL;
+	}
+	return &infos[col];
+}
+
+/*
+ * Seeks to a column and reads its payload, leaving the others unread.
+ * Columns can be read in any order. As with ArFrameReader::readPayload(),
+ * the length comes from the stream, so the payload is grown
+ * COLUMNS_READ_CHUNK bytes at a time as they arrive.
+ *
+ * Returns false if the stream ends before the payload does.
+ */
+bool ArColumnReader::readPayload(int col, std::string* payload){
+	const ArColumnInfo* info = getInfo(col);
+	if (info == NULL || payload == NULL){
+		return false;
+	}
+
+	in->clear();
+	in->seekg(base + (std::streamoff) info->offset);
+
+	payload->clear();
+	while (payload->size() < info->length){
+		size_t done = payload->size();
+		size_t n = info->length - done < COLUMNS_READ_CHUNK ? info->length - done : COLUMNS_READ_CHUNK;
+		payload->resize(done + n);
+		in->read(&(*payload)[done], n);
+		if (!in->good()){
+			payload->resize(done + in->gcount());
+			return false;
+		}
+	}
+	return in->good();
+}
+
+/*
+ * Decodes a byte column into dst, which must have room for info.symbols
+ * characters.
+ *
+ * Like ArFrameReader::decodeFrame(), this touches nothing but its
+ * arguments, so separate columns may be decoded on separate threads.
+ *
+ * Returns false if the column is not a byte column.
+ */
+bool ArColumnReader::decodeBytes(const ArColumnInfo& info, const std::string& payload, uint8_t* dst){
+	if (info.kind != COLUMN_BYTES){
+		return false;
+	}
+
+	std::istringstream iss(payload);
+	Model m;
+	m.flatten();
+
+	ArDecoder ard(&m, &iss);
+	for (uint64_t i = 0; i < info.symbols; i++){
+		dst[i] = ard.get();
+		m.adapt(dst[i]);
+	}
+
+	return true;
+}
+
+/*
+ * Decodes an int column into dst, which must have room for info.symbols
+ * values. See decodeBytes().
+ *
+ * Returns false if the column is not an int column.
+ */
+bool ArColumnReader::decodeInts(const ArColumnInfo& info, const std::string& payload, int64_t* dst){
+	if (info.kind != COLUMN_INTS){
+		return false;
+	}
+
+	std::istringstream iss(payload);
+	IntDecoder ind(&iss, info.transform);
+	ind.get(dst, info.symbols);
+
+	return true;
+}
@@ -0,0 +1,96 @@
+#ifndef ARCOLUMNS_INCLUDED
+#define ARCOLUMNS_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class Model;
+class ArEncoder;
+class IntEncoder;
+
+/*
+ * Columnar container format
+ *
+ * Header:			'A' 'r' 'C' 'c' <version> <columns>
+ * Each column:		<kind> <transform> <symbols> <offset> <length>
+ * Then:			the payloads, in column order
+ *
+ * kind and transform are one byte, columns is a 32 bit value, and
+ * symbols, offset, and length are 64 bit values. offset counts from the
+ * first payload. Every column is coded separately with its own Model
+ * (or IntModels), so a reader can seek to just the columns it needs and
+ * decode them independently, on separate threads if it likes.
+ */
+
+const uint8_t COLUMNS_VERSION = 1;
+const uint32_t COLUMNS_MAX = 0x1 << 16;		// Columns in one container
+const size_t COLUMNS_READ_CHUNK = 0x1 << 20;	// Payload bytes read at a time, so corrupt lengths cannot allocate much
+
+// Column kinds
+const uint8_t COLUMN_BYTES	= 0x0;	// Characters, with an adaptive Model
+const uint8_t COLUMN_INTS	= 0x1;	// int64_t values, with IntEncoder and the column's transform
+
+struct ArColumnInfo{
+	uint8_t kind;
+	uint8_t transform;
+	uint64_t symbols;
+	uint64_t offset;
+	uint64_t length;
+};
+
+class ArColumnWriter{
+public:
+	ArColumnWriter(std::ostream* out);
+	~ArColumnWriter();
+	ArColumnWriter(const ArColumnWriter&) = delete;
+	ArColumnWriter& operator=(const ArColumnWriter&) = delete;
+
+	int addByteColumn();
+	int addIntColumn(int transform);
+
+	bool putByte(int col, uint8_t c);
+	bool putBytes(int col, const uint8_t* src, size_t count);
+	bool putInt(int col, int64_t v);
+	bool putInts(int col, const int64_t* src, size_t count);
+
+	bool finish();
+private:
+	// A column's coder, and the substream it writes into until finish()
+	struct Column{
+		ArColumnInfo info;
+		std::ostringstream data;
+		Model* model;
+		ArEncoder* are;
+		IntEncoder* ie;
+	};
+
+	std::ostream* out;
+	std::vector<Column*> columns;
+	bool finished;
+
+	Column* getColumn(int col, uint8_t kind);
+};
+
+class ArColumnReader{
+public:
+	ArColumnReader(std::istream* in);
+	~ArColumnReader();
+
+	bool readHeader();
+	int getColumnCount();
+	const ArColumnInfo* getInfo(int col);
+	bool readPayload(int col, std::string* payload);
+
+	static bool decodeBytes(const ArColumnInfo& info, const std::string& payload, uint8_t* dst);
+	static bool decodeInts(const ArColumnInfo& info, const std::string& payload, int64_t* dst);
+private:
+	std::istream* in;
+	std::vector<ArColumnInfo> infos;
+	std::streampos base;	// Where the first payload starts
+};
+
+#endif
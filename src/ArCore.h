@@ -0,0 +1,446 @@
+#ifndef ARCORE_INCLUDED
+#define ARCORE_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <stdint.h>
+
+// Decoder flags
+const char STREAM_NULL		= 0x1;
+const char MODEL_NULL		= 0x2;
+const char STREAM_NOT_GOOD	= 0x4;
+
+inline int leadingZeros(uint32_t x){
+	return __builtin_clz(x);
+}
+
+inline int leadingZeros(uint64_t x){
+	return __builtin_clzll(x);
+}
+
+/*
+ * The steps that widen the interval again after a character has
+ * narrowed it, on their own, so that every coder takes them the same
+ * way whatever it does with the bits.
+ *
+ * The leading bits that top and bot agree on are settled: the encoder
+ * outputs them and the decoder reads as many. dropSettled() shifts them
+ * out, loading 1s into top and 0s into bot.
+ */
+template <class W>
+inline int settledBits(W top, W bot){
+	return leadingZeros((W) (top ^ bot));
+}
+
+template <class W>
+inline void dropSettled(W* top, W* bot, int count){
+	*top = (*top << count) | (((W) 1 << count) - 1);
+	*bot <<= count;
+}
+
+/*
+ * Widens an interval that straddles the middle, where the second bit of
+ * bot is 1 and of top is 0, by removing the second bits until it does
+ * not. Returns the number removed: the encoder holds that many pending
+ * bits, and the decoder reads that many.
+ */
+template <class W>
+inline int dropStraddled(W* top, W* bot){
+	const int bits = sizeof(W) * 8;
+	int count = 0;
+	while ((*top & ((W) 1 << (bits - 2))) < (*bot & ((W) 1 << (bits - 2)))){
+		// Remove the second bit of top and load a 1 in the back
+		*top = (*top << 1) | ((W) 1 << (bits - 1)) | 1;
+
+		// Remove the second bit of bot and leave a 0 in the back
+		*bot = (*bot << 1) & ~((W) 1 << (bits - 1));
+		count++;
+	}
+	return count;
+}
+
+/*
+ * The parts of the coders that do not depend on the Model: the interval,
+ * its convergence, and the bit output or input, with W the word type of
+ * the interval and of the stream (uint32_t for ArEncoder and ArDecoder,
+ * uint64_t for WideArEncoder and WideArDecoder). The coders narrow top
+ * and bot with their Models and then call converge().
+ */
+template <class W>
+class ArEncoderCore{
+public:
+	int finish();
+	int flush();
+
+	bool saveState(std::ostream* state);
+	bool loadState(std::istream* state);
+protected:
+	std::ostream* out;
+	W buf;
+	int pending;
+	int bufcurs;
+	W top;
+	W bot;
+
+	static const int BITS = sizeof(W) * 8;
+
+	/*
+	 * Starts a new stream to outstream, with the full interval.
+	 */
+	void start(std::ostream* outstream){
+		out = outstream;
+
+		bufcurs = BITS - 1;
+		buf = 0;
+		pending = 0;
+
+		top = ~(W) 0;
+		bot = 0;
+	}
+
+	/*
+	 * Outputs the bits that top and bot have settled on after narrowing,
+	 * and widens the interval again.
+	 */
+	inline void converge(){
+		removeFirstConvergence();
+		removeSecondConvergence();
+	}
+private:
+	inline void removeFirstConvergence(){
+		// Output the settled bits, with the pending bits after the first
+		int count = settledBits(top, bot);
+		if (count > 0){
+			outputBit(top >> (BITS - 1));
+			outputPending(top >> (BITS - 1));
+			if (count > 1){
+				outputBits(top >> (BITS - count), count - 1);
+			}
+			dropSettled(&top, &bot, count);
+		}
+	}
+
+	inline void removeSecondConvergence(){
+		pending += dropStraddled(&top, &bot);
+	}
+
+	/*
+	 * Performs a buffered output. Uses only the rightmost bit of c.
+	 * Returns true if the buffer was output, false otherwise.
+	 *
+	 * Since it is private, it assumes that error checking on out
+	 * has already been done if it is being called.
+	 */
+	inline bool outputBit(uint8_t c){
+		bool ret = false;
+		buf |= ((W) c & 0x1) << bufcurs;
+		bufcurs--;
+
+		if (bufcurs < 0){
+			out->write((char*) &buf, sizeof(buf));
+			buf = 0;
+			bufcurs = BITS - 1;
+			ret = true;
+		}
+
+		return ret;
+	}
+
+	inline bool outputBits(W bits, int count){
+		bool ret = false;
+
+		// Determine the number that will fit normally
+		int fit = (bufcurs + 1 < count) ? bufcurs + 1 : count;
+		W mask = ((W) 1 << fit) - 1;
+		buf |= (mask & (bits >> (count - fit))) << (bufcurs - fit + 1);
+		bufcurs -= fit;
+
+		// Output if necessary
+		if (bufcurs < 0){
+			out->write((char*) &buf, sizeof(buf));
+			buf = 0;
+			bufcurs = BITS - 1;
+			ret = true;
+
+			// Shove the rest in
+			if (count - fit > 0){
+				mask = ((W) 1 << (count - fit)) - 1;	// Mask for remainder
+				buf |= (mask & bits) << (bufcurs - (count - fit) + 1);	// Put the remainder in
+				bufcurs -= count - fit;	// Track the cursor
+			}
+		}
+
+		// Do not need to output again (added at most BITS - 1 bits in the
+		// second round)
+
+		return ret;
+	}
+
+	/*
+	 * Outputs the pending bits as the inverse of the rightmost bit of c.
+	 */
+	inline int outputPending(uint8_t c){
+		int ret = pending;
+		while (pending > 0){
+			outputBit(~c & 0x1);
+			pending--;
+		}
+
+		return ret;
+	}
+};
+
+/*
+ * Outputs the buffer, bot, and all pending bits.
+ * Pending bits can be either 0 or 1 depending on whether the range
+ * converges towards bot or top, so since bot is used here, pending
+ * bits are treated as 1s.
+ *
+ * If out is NULL, returns -1. Otherwise, returns the number of
+ * bits that were output.
+ */
+template <class W>
+int ArEncoderCore<W>::finish(){
+	if (out == NULL){
+		return -1;
+	}
+
+	int ret = BITS + pending + BITS - 1 - bufcurs;
+
+	// First bit of bot is always 0 - otherwise it would have converged
+	outputBit(0);
+	outputPending(0);
+
+	// Output the rest of bot
+	bool cleared = false;
+	for (int i = BITS - 2; i >= 0; i--){
+		cleared = outputBit((bot >> i) & 0x1);
+	}
+
+	if (!cleared){
+		out->write((char*) &buf, sizeof(buf));
+		buf = 0;
+		bufcurs = BITS - 1;
+	}
+
+	return ret;
+}
+
+/*
+ * Writes a sync point: everything encoded so far is output, up to
+ * a word boundary, and the stream is flushed, so a receiver can decode
+ * all of it without waiting for more. Unlike finish(), the stream goes
+ * on afterwards with the same Model (and whatever the caller has learned
+ * in it), in a fresh interval. The decoder must call sync() at the same
+ * point.
+ *
+ * A sync point costs one word plus the pending bits and padding, so 4 to
+ * 8 bytes for 32 bit words.
+ *
+ * If out is NULL, returns -1. Otherwise, returns the number of bits
+ * that were output from the internal buffers, as finish() does.
+ */
+template <class W>
+int ArEncoderCore<W>::flush(){
+	int ret = finish();
+	if (ret < 0){
+		return ret;
+	}
+
+	top = ~(W) 0;
+	bot = 0;
+	out->flush();
+
+	return ret;
+}
+
+/*
+ * Writes the coder's state to state: the interval, the pending bits, and
+ * the partly filled output word, 3 words and 2 ints in all. Nothing is
+ * output and the encoder carries on as it was. Restoring the state with
+ * loadState(), even in another process, lets the encoder carry on the
+ * same stream, as long as its output picks up where this one's left off
+ * and its Model is restored as well.
+ *
+ * Returns false if state is NULL or not good.
+ */
+template <class W>
+bool ArEncoderCore<W>::saveState(std::ostream* state){
+	if (state == NULL){
+		return false;
+	}
+
+	state->write((char*) &top, sizeof(top));
+	state->write((char*) &bot, sizeof(bot));
+	state->write((char*) &pending, sizeof(pending));
+	state->write((char*) &buf, sizeof(buf));
+	state->write((char*) &bufcurs, sizeof(bufcurs));
+
+	return state->good();
+}
+
+/*
+ * Reads a state written by saveState(). The Model and output stream are
+ * left as they are.
+ *
+ * Returns false, leaving the encoder as it was, if state is NULL, cannot
+ * be read, or does not hold a possible state.
+ */
+template <class W>
+bool ArEncoderCore<W>::loadState(std::istream* state){
+	if (state == NULL){
+		return false;
+	}
+
+	W t, b, w;
+	int p, c;
+	state->read((char*) &t, sizeof(t));
+	state->read((char*) &b, sizeof(b));
+	state->read((char*) &p, sizeof(p));
+	state->read((char*) &w, sizeof(w));
+	state->read((char*) &c, sizeof(c));
+
+	// The first bits of top and bot always differ between characters
+	if (!state->good() || b >= t || (t ^ b) >> (BITS - 1) == 0 || p < 0 || c < 0 || c >= BITS){
+		return false;
+	}
+
+	top = t;
+	bot = b;
+	pending = p;
+	buf = w;
+	bufcurs = c;
+
+	return true;
+}
+
+template <class W>
+class ArDecoderCore{
+public:
+	void sync();
+	uint8_t getFlags();
+protected:
+	std::istream* in;
+	uint8_t flags;
+	W buf;
+	int bufcurs;
+	W top;
+	W bot;
+	W cur;
+
+	static const int BITS = sizeof(W) * 8;
+
+	/*
+	 * Starts decoding a new stream from instream, reading its first word
+	 * straight away. Only STREAM_NULL is set, if instream is NULL.
+	 */
+	void start(std::istream* instream){
+		in = instream;
+
+		buf = 0;
+		bufcurs = 0;
+		cur = 0;
+
+		flags = 0;
+		if (in == NULL){
+			flags |= STREAM_NULL;
+		} else{
+			in->read((char*) &cur, sizeof(cur));
+		}
+
+		top = ~(W) 0;
+		bot = 0;
+	}
+
+	/*
+	 * Drops the bits that top and bot have settled on after narrowing,
+	 * and reads in as many.
+	 */
+	inline void converge(){
+		removeFirstConvergence();
+		removeSecondConvergence();
+	}
+private:
+	inline void removeFirstConvergence(){
+		// Discard the settled bits of top, bot, and cur, loading cur's
+		// from the stream
+		int count = settledBits(top, bot);
+		dropSettled(&top, &bot, count);
+		for (int i = 0; i < count; i++){
+			cur = (cur << 1) | (getBit() & 0x1);
+		}
+	}
+
+	inline void removeSecondConvergence(){
+		int count = dropStraddled(&top, &bot);
+		for (int i = 0; i < count; i++){
+			// Remove the second bit of cur
+			cur <<= 1;	// Second bit is opposite of first bit so don't lose it
+			cur ^= (W) 0x1 << (BITS - 1);	// Restore the first bit by inverting the new first bit
+			cur |= getBit() & 0x1;
+		}
+	}
+
+	/*
+	 * Gets a bit from the internal buffer. If the internal buffer is
+	 * emptied, reads a new word from in, and sets STREAM_NOT_GOOD if that
+	 * fails.
+	 */
+	inline char getBit(){
+		if (flags & (STREAM_NULL | STREAM_NOT_GOOD)){
+			return 0;
+		}
+
+		if (bufcurs-- < 1){
+			if (in->good()){
+				in->read((char*) &buf, sizeof(buf));
+				bufcurs = BITS - 1;
+			} else{
+				flags |= STREAM_NOT_GOOD;
+				return 0;
+			}
+		}
+
+		return (buf >> bufcurs) & 0x1;
+	}
+};
+
+/*
+ * Moves past a sync point written by flush(), once every symbol before
+ * it has been decoded. Decoding those symbols never reads past the sync
+ * point, so a receiver can decode everything sent so far.
+ *
+ * Like start(), this reads the first word after the sync point straight
+ * away, so on a live stream call it just before decoding the next batch
+ * rather than just after the last one.
+ */
+template <class W>
+void ArDecoderCore<W>::sync(){
+	if (flags & STREAM_NULL){
+		return;
+	}
+
+	// The sync point ends on a word boundary, so the rest of buf is
+	// padding
+	buf = 0;
+	bufcurs = 0;
+
+	cur = 0;
+	in->read((char*) &cur, sizeof(cur));
+
+	top = ~(W) 0;
+	bot = 0;
+}
+
+/*
+ * Returns the internal flags.
+ * If STREAM_NULL or MODEL_NULL are set, all get() calls will fail.
+ * If STREAM_NOT_GOOD is set, get() calls may continue, but may result in
+ * undefined behavior after an unspecified number of get calls.
+ */
+template <class W>
+uint8_t ArDecoderCore<W>::getFlags(){
+	return flags;
+}
+
+#endif
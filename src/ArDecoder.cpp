@@ -1,118 +1,63 @@
 #include "ArDecoder.h"
 #include "Model.h"
-#include "bitTwiddle.h"
-
 
 ArDecoder::ArDecoder(Model* model, std::istream* instream){
-	m = model;
-	in = instream;
+	reset(model, instream);
+}
 
-	buf = 0;
-	bufcurs = 0;
+ArDecoder::~ArDecoder(){}
 
-	flags = 0;
+/*
+ * Starts decoding a new stream from instream with model, exactly as if
+ * the decoder had just been constructed. Like the constructor, it reads
+ * the first 32 bits of the stream straight away.
+ */
+void ArDecoder::reset(Model* model, std::istream* instream){
+	m = model;
+
+	// A NULL Model is fine here, since one can be set later or symbols
+	// decoded with a LargeModel
+	start(instream);
 	if (m == NULL){
 		flags |= MODEL_NULL;
 	}
-	if (in == NULL){
-		flags |= STREAM_NULL;
-	}
+}
 
-	if (!flags){
-		in->read((char*) &cur, sizeof(cur));
+/*
+ * Switches the Model used for the following characters.
+ */
+void ArDecoder::setModel(Model* model){
+	m = model;
+	if (m == NULL){
+		flags |= MODEL_NULL;
+	} else{
+		flags &= ~MODEL_NULL;
 	}
-
-	top = ~0;
-	bot = 0;
-} 
-
-ArDecoder::~ArDecoder(){}
+}
 
 uint8_t ArDecoder::get(){
 	if (flags & MODEL_NULL){
 		return 0;
 	}
 
-	uint8_t c = m->getChar(cur, bot, top);
-
-	uint32_t tmp = top;
-	top = m->calcUpper(c, bot, top);
-	bot = m->calcLower(c, bot, tmp);
-
-	removeFirstConvergence();
-	removeSecondConvergence();
-
-	return c;
-}
-
-inline void ArDecoder::removeFirstConvergence(){
-	// While the first bit of top and bot are the same
-	while (SELECT_BIT_FRONT(1, ~(top ^ bot))){
-		// Discard the first bit of top, bot, cur
-
-		// Load 1 into top
-		top <<= 1;
-		top |= 0x1;
-
-		// Load 0 into bot
-		bot <<= 1;
-
-		// Load bit from stream into cur
-		cur <<= 1;
-		cur |= getBit() & 0x1;
-	}
-}
-
-inline void ArDecoder::removeSecondConvergence(){
-	// While the second bit of bot is 1 and of top is 0
-	while (SELECT_BIT_FRONT(2, top) < SELECT_BIT_FRONT(2, bot)){
-
-		// Remove the second bit of top and load a 1 in the back
-		top = (top << 1) | (1 << (sizeof(top) * 8 - 1));
-		top |= 0x1;
-
-		// Remove the second bit of bot and leave a 0 in back
-		bot = (bot << 1) & ~(1 << (sizeof(bot) * 8 - 1));
-
-		// Remove the second bit of bot
-		cur <<= 1;	// Second bit is opposite of first bit so don't lose it
-		cur ^= 0x1 << (sizeof(cur) * 8 - 1);	// Restore the first bit by inverting the new first bit
-		cur |= getBit() & 0x1;
-	}
-}
-
-/*
- * Returns the internal flags. 
- * If STREAM_NULL or MODEL_NULL are set, all get() calls will fail.
- * If STREAM_NOT_GOOD is set, get() calls may continue, but may result in 
- * undefined behavior after an unspecified number of get calls.
- */
-uint8_t ArDecoder::getFlags(){
-	return flags;
+	return get(m);
 }
 
 /*
- * Gets a bit from the internal buffer. If the internal buffer is emptied,
- * reads a new buffer from in and sets a flag if this fails.
- *
- * If a flag is set when getBit is called, it will fail and return 0;
+ * Decodes count characters into dst.
  *
- * Assumes that in is not null.
+ * The stopping condition is the count alone, so the loop does no
+ * per-character checks. Returns the number of characters decoded,
+ * which is 0 if the Model is NULL.
  */
-inline char ArDecoder::getBit(){
-	if (flags){
+size_t ArDecoder::get(uint8_t* dst, size_t count){
+	if (flags & MODEL_NULL){
 		return 0;
 	}
 
-	if (bufcurs-- < 1){
-		if (in->good()){
-			in->read((char*) &buf, sizeof(buf));
-			bufcurs = sizeof(buf) * 8 - 1;
-		} else{
-			flags |= STREAM_NOT_GOOD;
-			return 0;
-		}
+	for (size_t i = 0; i < count; i++){
+		dst[i] = get(m);
 	}
 
-	return (buf >> bufcurs) & 0x1;
-}
\ No newline at end of file
+	return count;
+}
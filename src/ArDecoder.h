@@ -1,37 +1,66 @@
 #ifndef ARDE_INCLUDED
 #define ARDE_INCLUDED
 
-#include <istream>
+#include <stddef.h>
 #include <stdint.h>
+#include <type_traits>
+#include "ArCore.h"
 
 class Model;
 
-// Flags
-const char STREAM_NULL		= 0x1;
-const char MODEL_NULL		= 0x2;
-const char STREAM_NOT_GOOD	= 0x4;
-
-
-class ArDecoder{
+class ArDecoder : public ArDecoderCore<uint32_t>{
 public:
 	ArDecoder(Model* m, std::istream* in);
 	~ArDecoder();
 
+	void reset(Model* m, std::istream* in);
+	void setModel(Model* m);
+
 	uint8_t get();
-	uint8_t getFlags();
+	size_t get(uint8_t* dst, size_t count);
+
+	/*
+	 * Decodes a character or symbol with model instead of the current
+	 * Model, which is left alone and may even be NULL. model is not
+	 * updated. Any class with calcUpper(), calcLower(), and getChar()
+	 * will do, and the result has the type its getChar() returns.
+	 *
+	 * Returns 0 if model is NULL.
+	 */
+	template <class M>
+	auto get(M* model) -> typename std::enable_if<std::is_class<M>::value, decltype(model->getChar(0, 0, 0))>::type{
+		if (model == NULL){
+			return 0;
+		}
+
+		decltype(model->getChar(0, 0, 0)) c = model->getChar(cur, bot, top);
+
+		uint32_t tmp = top;
+		top = model->calcUpper(c, bot, top);
+		bot = model->calcLower(c, bot, tmp);
+		converge();
+
+		return c;
+	}
+
+	/*
+	 * Decodes count characters into dst with model, as above. Returns the
+	 * number of characters decoded, which is 0 if model is NULL.
+	 */
+	template <class M>
+	size_t get(M* model, uint8_t* dst, size_t count){
+		if (model == NULL){
+			return 0;
+		}
+
+		for (size_t i = 0; i < count; i++){
+			dst[i] = get(model);
+		}
+
+		return count;
+	}
 private:
 	Model* m;
-	std::istream* in;
-	uint8_t flags;
-	uint32_t buf;
-	int bufcurs;
-	uint32_t top;
-	uint32_t bot;
-	uint32_t cur;
-
-	inline char getBit();
-	inline void removeFirstConvergence();
-	inline void removeSecondConvergence();
 };
 
 #endif
\ No newline at end of file
@@ -1,21 +1,47 @@
 #include "ArEncoder.h"
 #include "Model.h"
-#include "bitTwiddle.h"
 
-ArEncoder::ArEncoder(Model* model, std::ostream* outstream){
-	m = model;
-	out = outstream;
+__extension__ typedef unsigned __int128 uint128_t;
 
-	bufcurs = sizeof(buf) * 8 - 1;
-	buf = 0;
-	pending = 0;
+/*
+ * n / d rounded up, for n below 2 ^ 63 and d from 2 to 2 ^ 32, given
+ * recip = (2 ^ 64 - 1) / d. The product's high half is the quotient or
+ * one short of it, so a single correction makes it exact, with two
+ * multiplies in place of a division.
+ */
+static inline uint64_t ceilDiv(uint64_t n, uint64_t d, uint64_t recip){
+	uint64_t q = (uint64_t) (((uint128_t) n * recip) >> 64);
+	uint64_t r = n - q * d;
+	uint64_t over = r >= d;
+	q += over;
+	r -= over * d;
+	return q + (r != 0);
+}
 
-	top = ~0;
-	bot = 0;
+ArEncoder::ArEncoder(Model* model, std::ostream* outstream){
+	reset(model, outstream);
 }
 
 ArEncoder::~ArEncoder(){}
 
+/*
+ * Starts a new stream to outstream with model, exactly as if the encoder
+ * had just been constructed. Anything not yet finished is dropped, so
+ * call finish() first to keep the previous stream.
+ */
+void ArEncoder::reset(Model* model, std::ostream* outstream){
+	m = model;
+	start(outstream);
+}
+
+/*
+ * Switches the Model used for the following characters. This lets
+ * a single stream code different kinds of values with separate Models.
+ */
+void ArEncoder::setModel(Model* model){
+	m = model;
+}
+
 /*
  * Encodes a character. 
  * If m or out are NULL, returns false and does not encode. 
@@ -26,148 +52,62 @@ bool ArEncoder::put(uint8_t c){
 		return false;
 	}
 
-	uint32_t tmp = top;
-	top = m->calcUpper(c, bot, top);
-	bot = m->calcLower(c, bot, tmp);
-
-	removeFirstConvergence();
-	removeSecondConvergence();
-
-	return true;
-}
-
-#include <iostream>
-inline void ArEncoder::removeFirstConvergence(){
-	// Remove front matching bits
-	int count = __builtin_clz(top ^ bot);
-	if (count > 0){
-		outputBit(top >> (sizeof(top) * 8 - 1));
-		outputPending(top >> (sizeof(top) * 8 - 1));
-		if (count > 1){
-			outputBits(top >> (sizeof(top) * 8 - count), count - 1); // TODO outputting wrong?
-		}
-		top <<= count;
-		top |= (1 << count) - 1;
-
-		bot <<= count;
-	}
-
-
-}
-
-inline void ArEncoder::removeSecondConvergence(){
-	// While the second bit of bot is 1 and of top is 0
-	while (SELECT_BIT_FRONT(2, top) < SELECT_BIT_FRONT(2, bot)){
-		pending++;
-
-		// Remove the second bit of top and load a 1 in the back
-		top = (top << 1) | (1 << (sizeof(top) * 8 - 1));
-		top |= 1;
-
-		// Remove the second bit of bot and leave a 0 in the back
-		bot = (bot << 1) & ~(1 << (sizeof(bot) * 8 - 1));
-	}
+	return put(m, c);
 }
 
 /*
- * Outputs the buffer, bot, and all pending bits.
- * Pending bits can be either 0 or 1 depending on whether the range
- * converges towards bot or top, so since bot is used here, pending
- * bits are treated as 1s.
+ * Encodes count characters from src.
+ * If m or out are NULL, returns false and does not encode.
+ * Otherwise, returns true.
  *
- * If out is NULL, returns -1. Otherwise, returns the number of 
- * bits that were output.
+ * The Model cannot change during the call, so this works in two phases
+ * on each ENCODE_CHUNK characters. First the bounds of all of them are
+ * looked up at once with Model::gather(), which uses vector gathers where
+ * the processor has them. Then narrow() runs over the prepared bounds,
+ * so the serial chain from one character to the next holds only the
+ * interval math and the output. The stream is exactly the same as
+ * put(c) for each character.
  */
-int ArEncoder::finish(){
-	if (out == NULL){
-		return -1;
+bool ArEncoder::put(const uint8_t* src, size_t count){
+	if (m == NULL || out == NULL){
+		return false;
 	}
 
-	int ret = sizeof(bot) * 8 + pending + sizeof(buf) * 8 - 1 - bufcurs;
-
-	// First bit of bot is always 0 - otherwise it would have converged
-	outputBit(0);
-	outputPending(0);
-
-	// Output the rest of bot
-	bool cleared = false;
-	for(int i = 30; i >= 0; i--){
-		cleared = outputBit((bot >> i) & 0x1);
-	}
+	uint32_t lows[ENCODE_CHUNK];
+	uint32_t highs[ENCODE_CHUNK];
+	for (size_t i = 0; i < count; i += ENCODE_CHUNK){
+		size_t n = count - i < ENCODE_CHUNK ? count - i : ENCODE_CHUNK;
+
+		if (!m->gather(src + i, n, lows, highs)){
+			// A character without a slot takes the shadow value
+			for (size_t j = 0; j < n; j++){
+				put(m, src[i + j]);
+			}
+			continue;
+		}
 
-	if (!cleared){
-		out->write((char*) &buf, sizeof(buf));
-		buf = 0;
-		bufcurs = sizeof(buf) * 8 - 1;
+		// Every character has a slot, so scale is at least 2
+		uint64_t scale = (uint64_t) m->getTotal() + 1;
+		uint64_t recip = ~(uint64_t) 0 / scale;
+		for (size_t j = 0; j < n; j++){
+			narrow(lows[j] + 1, highs[j] + 1, scale, recip);
+		}
 	}
 
-	return ret;
+	return true;
 }
 
 /*
- * Performs a buffered output. Uses only the rightmost bit of c.
- * Returns true if the buffer was output, false otherwise.
- *
- * Since it is private, it assumes that error checking on out
- * has already been done if it is being called.
+ * Narrows the interval to a character's bounds, already offset by 1 for
+ * the shadow value, out of scale. This is Model::calcUpper() and
+ * Model::calcLower() without the lookups, and with the divisions by
+ * scale done through its reciprocal.
  */
-inline bool ArEncoder::outputBit(uint8_t c){
-	bool ret = false;
-	buf |= ((uint32_t)c & 0x1) << bufcurs;
-	bufcurs--;
-
-	if (bufcurs < 0){
-		out->write((char*) &buf, sizeof(buf));
-		buf = 0;
-		bufcurs = sizeof(buf) * 8 - 1;
-		ret = true;
-	}
-
-	return ret;
-}
-
-inline bool ArEncoder::outputBits(uint32_t bits, int count){
-	bool ret = false;
-
-	// Determine the number that will fit normally
-	int fit = (bufcurs + 1 < count) ? bufcurs + 1 : count;
-	uint32_t mask = (1 << (fit)) - 1;
-	buf |= (mask & (bits >> (count - fit))) << (bufcurs - fit + 1);
-	bufcurs -= fit;
-
-
-	// Output if necessary
-	if (bufcurs < 0){
-		out->write((char*) &buf, sizeof(buf));
-		buf = 0;
-		bufcurs = sizeof(buf) * 8 - 1;
-		ret = true;
-
-		// Shove the rest in
-		if (count - fit > 0){
-			mask = (1 << (count - fit)) - 1;	// Mask for remainder
-			buf |= (mask & bits) << (bufcurs - (count - fit) + 1);	// Put the remainder in
-			bufcurs -= count - fit;	// Track the cursor
-		}
-	}
-
-	// Do not need to output again (added max 31 bits in second round)
+inline void ArEncoder::narrow(uint64_t low, uint64_t high, uint64_t scale, uint64_t recip){
+	uint64_t range = (uint64_t) top + 1 - bot;
 
-	return ret;
-}
+	top = bot + (uint32_t) ceilDiv(high * range, scale, recip) - 1;
+	bot = bot + (uint32_t) ceilDiv(low * range, scale, recip);
 
-/*
- * Outputs the pending bits as the inverse of the rightmost bit of c.
- *
- * This is a private function so it is assumed that out has been
- * NULL checked if it is called.
- */
-inline int ArEncoder::outputPending(uint8_t c){
-	int ret = pending;
-	while(pending > 0){
-		outputBit(~c & 0x1);
-		pending--;
-	}
-	
-	return ret;
+	converge();
 }
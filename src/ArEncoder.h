@@ -1,33 +1,68 @@
 #ifndef AREN_INCLUDED
 #define AREN_INCLUDED
 
-#include <ostream>
+#include <stddef.h>
 #include <stdint.h>
+#include <type_traits>
+#include "ArCore.h"
+
+const size_t ENCODE_CHUNK = 512;	// Characters looked up at a time by put(src, count)
+const size_t ENCODER_STATE_SIZE = 20;	// Bytes written by saveState()
 
 class Model;
 
-class ArEncoder{
+class ArEncoder : public ArEncoderCore<uint32_t>{
 public:
 	ArEncoder(Model* m, std::ostream* out);
 	~ArEncoder();
 
+	void reset(Model* m, std::ostream* out);
+	void setModel(Model* m);
+
 	bool put(uint8_t c);
-	int finish();
+	bool put(const uint8_t* src, size_t count);
+
+	/*
+	 * Encodes a character or symbol with model instead of the current
+	 * Model, in the same stream. model is not updated. Any class with
+	 * calcUpper() and calcLower() will do, such as LargeModel, BitModel,
+	 * CompactModel, ShiftModel, and OverlayModel.
+	 * If model or out are NULL, returns false and does not encode.
+	 * Otherwise, returns true.
+	 */
+	template <class M, class S>
+	typename std::enable_if<std::is_class<M>::value, bool>::type put(M* model, S c){
+		if (model == NULL || out == NULL){
+			return false;
+		}
+
+		uint32_t tmp = top;
+		top = model->calcUpper(c, bot, top);
+		bot = model->calcLower(c, bot, tmp);
+		converge();
+
+		return true;
+	}
+
+	/*
+	 * Encodes count characters from src with model, as above.
+	 */
+	template <class M>
+	bool put(M* model, const uint8_t* src, size_t count){
+		if (model == NULL || out == NULL){
+			return false;
+		}
+
+		for (size_t i = 0; i < count; i++){
+			put(model, src[i]);
+		}
+
+		return true;
+	}
 private:
 	Model* m;
-	std::ostream* out;
-	uint32_t buf;
-	int pending;
-	int bufcurs;
-	uint32_t top;
-	uint32_t bot;
-
-	inline bool outputBits(uint32_t bits, int count);
-	inline bool outputBit(uint8_t c);
-	inline int outputPending(uint8_t c);
-
-	inline void removeFirstConvergence();
-	inline void removeSecondConvergence();
+
+	inline void narrow(uint64_t low, uint64_t high, uint64_t scale, uint64_t recip);
 };
 
 #endif
\ No newline at end of file
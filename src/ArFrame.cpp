@@ -0,0 +1,591 @@
+#include "ArFrame.h"
+#include "ArEncoder.h"
+#include "ArDecoder.h"
+#include "Model.h"
+#include "Lz.h"
+#include "Bwt.h"
+#include "Mix.h"
+#include "ModelRegistry.h"
+#include "Huffman.h"
+#include "Kernels.h"
+
+#include <cmath>
+#include <string.h>
+
+const char FRAME_MAGIC[3] = {'A', 'r', 'C'};
+
+/*
+ * Adds count characters to m in one go, halving m first as often as
+ * needed to stay within the precision limits. This is the update step of
+ * ENGINE_DEFERRED frames.
+ */
+static void foldUpdates(Model* m, const uint8_t* src, uint32_t count){
+	while (!m->ingest(src, count)){
+		m->rescale();
+	}
+}
+
+ArFrameWriter::ArFrameWriter(std::ostream* outstream){
+	out = outstream;
+	bypass = true;
+}
+
+ArFrameWriter::~ArFrameWriter(){}
+
+/*
+ * Writes the magic and version. This must come before any frames.
+ * Returns false if out is NULL or not good.
+ */
+bool ArFrameWriter::putStreamHeader(){
+	if (out == NULL){
+		return false;
+	}
+
+	out->write(FRAME_MAGIC, sizeof(FRAME_MAGIC));
+	out->put((char) FRAME_VERSION);
+
+	return out->good();
+}
+
+/*
+ * Encodes count characters from src as an ENGINE_STATIC frame.
+ * m is not modified, and the same Model must be given to decodeFrame().
+ */
+bool ArFrameWriter::putFrame(Model* m, const uint8_t* src, uint32_t count){
+	if (m == NULL){
+		return false;
+	}
+
+	if (bypass && isIncompressible(src, count)){
+		return putStoredFrame(src, count);
+	}
+
+	scratch.str("");
+	ArEncoder are(m, &scratch);
+	are.put(src, count);
+	are.finish();
+
+	return putScratch(ENGINE_STATIC, src, count);
+}
+
+/*
+ * Encodes count characters from src as an ENGINE_ADAPTIVE frame. The
+ * frame starts from its own flat Model, so it can be decoded without
+ * any of the frames before it.
+ */
+bool ArFrameWriter::putAdaptiveFrame(const uint8_t* src, uint32_t count){
+	if (bypass && isIncompressible(src, count)){
+		return putStoredFrame(src, count);
+	}
+
+	Model m;
+	m.flatten();
+
+	scratch.str("");
+	ArEncoder are(&m, &scratch);
+	for (uint32_t i = 0; i < count; i++){
+		are.put(src[i]);
+		m.update(src[i]);
+	}
+	are.finish();
+
+	return putScratch(ENGINE_ADAPTIVE, src, count);
+}
+
+/*
+ * Encodes count characters from src as an ENGINE_DEFERRED frame. Like
+ * ENGINE_ADAPTIVE, the frame starts from its own flat Model, but the
+ * characters are only added to it after every interval of them (clamped
+ * to between 1 and FRAME_MAX_INTERVAL), with one histogram and one
+ * digest. Longer intervals code faster but adapt more slowly; an
+ * interval of 1 codes exactly as ENGINE_ADAPTIVE does.
+ */
+bool ArFrameWriter::putDeferredFrame(const uint8_t* src, uint32_t count, uint32_t interval){
+	if (bypass && isIncompressible(src, count)){
+		return putStoredFrame(src, count);
+	}
+
+	if (interval < 1){
+		interval = 1;
+	} else if (interval > FRAME_MAX_INTERVAL){
+		interval = FRAME_MAX_INTERVAL;
+	}
+
+	Model m;
+	m.flatten();
+
+	scratch.str("");
+	scratch.write((char*) &interval, sizeof(interval));
+	ArEncoder are(&m, &scratch);
+	for (uint32_t i = 0; i < count; i += interval){
+		uint32_t n = count - i < interval ? count - i : interval;
+		are.put(src + i, n);
+		foldUpdates(&m, src + i, n);
+	}
+	are.finish();
+
+	return putScratch(ENGINE_DEFERRED, src, count);
+}
+
+/*
+ * Compresses count characters from src as an ENGINE_MIX frame, with
+ * context mixing tables of 2 ^ tableBits buckets (clamped as by
+ * MixPredictor). The decoder needs the same amount of memory.
+ */
+bool ArFrameWriter::putMixFrame(const uint8_t* src, uint32_t count, int tableBits){
+	if (bypass && isIncompressible(src, count)){
+		return putStoredFrame(src, count);
+	}
+
+	uint8_t bits = tableBits < MIX_MIN_BITS ? MIX_MIN_BITS : (tableBits > MIX_MAX_BITS ? MIX_MAX_BITS : tableBits);
+
+	scratch.str("");
+	scratch.put(bits);
+	MixEncoder mxe(&scratch, bits);
+	mxe.put(src, count);
+	mxe.finish();
+
+	return putScratch(ENGINE_MIX, src, count);
+}
+
+/*
+ * Compresses count characters from src as an ENGINE_LZ77 frame, with
+ * the match finder settings of level.
+ */
+bool ArFrameWriter::putLzFrame(const uint8_t* src, uint32_t count, int level){
+	if (bypass && isIncompressible(src, count)){
+		return putStoredFrame(src, count);
+	}
+
+	scratch.str("");
+	LzEncoder lze(&scratch, level);
+	lze.put(src, count);
+	lze.finish();
+
+	return putScratch(ENGINE_LZ77, src, count);
+}
+
+/*
+ * Transforms and codes count characters from src as an ENGINE_BWT frame.
+ */
+bool ArFrameWriter::putBwtFrame(const uint8_t* src, uint32_t count){
+	if (bypass && isIncompressible(src, count)){
+		return putStoredFrame(src, count);
+	}
+
+	scratch.str("");
+	BwtEncoder bwe(&scratch);
+	bwe.put(src, count);
+	bwe.finish();
+
+	return putScratch(ENGINE_BWT, src, count);
+}
+
+/*
+ * Encodes count characters from src as an ENGINE_REGISTERED frame, with
+ * the Model in reg that suits them best. Only the Model's ID is stored,
+ * so the reader needs the same registry.
+ *
+ * If no Model has a slot for every character of src, this writes an
+ * ENGINE_ADAPTIVE frame instead, so nothing is lost.
+ */
+bool ArFrameWriter::putRegisteredFrame(ModelRegistry* reg, const uint8_t* src, uint32_t count){
+	if (reg == NULL){
+		return false;
+	}
+
+	if (bypass && isIncompressible(src, count)){
+		return putStoredFrame(src, count);
+	}
+
+	uint32_t counts[256] = {0};
+	getKernels()->histogram(src, count, counts);
+
+	int index = reg->choose(src, count);
+	if (index < 0 || !reg->covers(index, counts)){
+		// The sample can miss characters that the whole block has
+		index = reg->choose(counts);
+		if (index < 0 || !reg->covers(index, counts)){
+			return putAdaptiveFrame(src, count);
+		}
+	}
+
+	uint32_t id = reg->getId(index);
+	scratch.str("");
+	scratch.write((char*) &id, sizeof(id));
+	ArEncoder are(reg->getModel(index), &scratch);
+	are.put(src, count);
+	are.finish();
+
+	return putScratch(ENGINE_REGISTERED, src, count);
+}
+
+/*
+ * Encodes count characters from src as an ENGINE_HUFFMAN frame, with a
+ * code built from m, or from src itself if m is NULL. Characters of src
+ * that m has no count for are given one, so nothing is lost. The code
+ * lengths are stored in the frame, so the reader does not need m.
+ */
+bool ArFrameWriter::putHuffmanFrame(Model* m, const uint8_t* src, uint32_t count){
+	if (bypass && isIncompressible(src, count)){
+		return putStoredFrame(src, count);
+	}
+
+	uint32_t counts[256] = {0};
+	getKernels()->histogram(src, count, counts);
+	if (m != NULL){
+		for (int i = 0; i < 256; i++){
+			uint32_t freq = m->getCharCount(i);
+			counts[i] = freq ? freq : (counts[i] ? 1 : 0);
+		}
+	}
+
+	HuffmanCoder hc;
+	if (count > 0 && !hc.build(counts)){
+		return false;
+	}
+
+	std::string payload(HUFF_LENGTHS_SIZE + HuffmanCoder::bound(count), 0);
+	uint8_t* p = (uint8_t*) &payload[0];
+	hc.getLengths(p);
+	size_t length = count ? hc.encode(src, count, p + HUFF_LENGTHS_SIZE, payload.size() - HUFF_LENGTHS_SIZE) : 0;
+
+	return putCoded(ENGINE_HUFFMAN, src, count, payload.data(), HUFF_LENGTHS_SIZE + length);
+}
+
+/*
+ * Writes count characters from src as an ENGINE_STORED frame, as they
+ * are. Both writing and reading it are a plain copy.
+ */
+bool ArFrameWriter::putStoredFrame(const uint8_t* src, uint32_t count){
+	return putRawFrame(ENGINE_STORED, count, (const char*) src, count);
+}
+
+/*
+ * Writes an already encoded payload under its own frame header. This is
+ * the hook for engines that produce their payloads elsewhere.
+ */
+bool ArFrameWriter::putRawFrame(uint8_t engine, uint32_t symbols, const char* payload, uint32_t length){
+	if (out == NULL || engine == ENGINE_END){
+		return false;
+	}
+
+	out->put((char) engine);
+	out->write((char*) &symbols, sizeof(symbols));
+	out->write((char*) &length, sizeof(length));
+	out->write(payload, length);
+
+	return out->good();
+}
+
+/*
+ * Writes the end of stream marker. Does not flush or close out.
+ */
+bool ArFrameWriter::finish(){
+	if (out == NULL){
+		return false;
+	}
+
+	out->put((char) ENGINE_END);
+
+	return out->good();
+}
+
+/*
+ * Sets whether the frame functions above store blocks that will not
+ * shrink as ENGINE_STORED frames instead. It is on to begin with.
+ *
+ * With it on, a block is stored without being coded at all when
+ * isIncompressible() says so, and a block whose coded payload turns out
+ * no smaller than the block is stored in its place. Either way, no frame
+ * holds more than its characters plus the 9 byte header.
+ */
+void ArFrameWriter::setBypass(bool on){
+	bypass = on;
+}
+
+/*
+ * Estimates whether count characters from src are too close to random
+ * to be worth coding, such as already compressed or encrypted data. It
+ * looks at up to FRAME_SAMPLE_SIZE of them, in FRAME_SAMPLE_SPANS spans
+ * spread over src, and returns true if their order 0 entropy comes to at
+ * least FRAME_STORED_BITS per character. The estimate is corrected for
+ * the size of the sample, which on its own makes random data look a
+ * little compressible.
+ *
+ * Only the order 0 statistics are sampled, so this can miss long
+ * repeats that LZ77 or BWT could find. Blocks much smaller than the
+ * sample are never flagged, and are left to the check after coding.
+ */
+bool ArFrameWriter::isIncompressible(const uint8_t* src, uint32_t count){
+	uint32_t counts[256] = {0};
+	uint32_t n = count;
+	if (count <= FRAME_SAMPLE_SIZE){
+		getKernels()->histogram(src, count, counts);
+	} else{
+		uint32_t span = FRAME_SAMPLE_SIZE / FRAME_SAMPLE_SPANS;
+		uint32_t stride = (count - span) / (FRAME_SAMPLE_SPANS - 1);
+		for (uint32_t i = 0; i < FRAME_SAMPLE_SPANS; i++){
+			getKernels()->histogram(src + (size_t) i * stride, span, counts);
+		}
+		n = FRAME_SAMPLE_SIZE;
+	}
+	if (n == 0){
+		return false;
+	}
+
+	double bits = 0;
+	int seen = 0;
+	for (int i = 0; i < 256; i++){
+		if (counts[i] > 0){
+			bits -= counts[i] * log2((double) counts[i] / n);
+			seen++;
+		}
+	}
+
+	// Miller-Madow correction for the characters the sample never shows
+	double entropy = bits / n + (seen - 1) / (2.0 * n * log(2.0));
+	return entropy >= FRAME_STORED_BITS;
+}
+
+bool ArFrameWriter::putScratch(uint8_t engine, const uint8_t* src, uint32_t count){
+	const std::string& payload = scratch.str();
+	return putCoded(engine, src, count, payload.data(), payload.size());
+}
+
+/*
+ * Writes a coded payload, unless it is no smaller than the characters it
+ * codes and the bypass is on, in which case they are stored instead.
+ */
+bool ArFrameWriter::putCoded(uint8_t engine, const uint8_t* src, uint32_t count, const char* payload, size_t length){
+	if (bypass && length >= count){
+		return putStoredFrame(src, count);
+	}
+
+	return putRawFrame(engine, count, payload, length);
+}
+
+ArFrameReader::ArFrameReader(std::istream* instream){
+	in = instream;
+	version = 0;
+	ended = false;
+}
+
+ArFrameReader::~ArFrameReader(){}
+
+/*
+ * Reads and checks the magic and version.
+ * Returns false if they do not match, or the stream cannot be read.
+ */
+bool ArFrameReader::readStreamHeader(){
+	if (in == NULL){
+		return false;
+	}
+
+	char magic[sizeof(FRAME_MAGIC)];
+	in->read(magic, sizeof(magic));
+	version = in->get();
+
+	if (!in->good()){
+		return false;
+	}
+
+	for (unsigned int i = 0; i < sizeof(FRAME_MAGIC); i++){
+		if (magic[i] != FRAME_MAGIC[i]){
+			return false;
+		}
+	}
+
+	return version <= FRAME_VERSION;
+}
+
+uint8_t ArFrameReader::getVersion(){
+	return version;
+}
+
+/*
+ * Reads the next frame header into h. The payload must then be
+ * consumed with either skip() or readPayload().
+ *
+ * Returns false at the end of the stream or if the header could not
+ * be read. atEnd() tells the two apart.
+ */
+bool ArFrameReader::next(ArFrameHeader* h){
+	if (in == NULL || h == NULL){
+		return false;
+	}
+
+	h->engine = in->get();
+	if (!in->good()){
+		return false;
+	}
+	if (h->engine == ENGINE_END){
+		ended = true;
+		return false;
+	}
+
+	in->read((char*) &h->symbols, sizeof(h->symbols));
+	in->read((char*) &h->length, sizeof(h->length));
+
+	return in->good();
+}
+
+/*
+ * Whether next() has read the ENGINE_END marker. A stream that stops
+ * anywhere else has been cut short.
+ */
+bool ArFrameReader::atEnd(){
+	return ended;
+}
+
+/*
+ * Skips over the payload of h without decoding it.
+ */
+bool ArFrameReader::skip(const ArFrameHeader& h){
+	in->ignore(h.length);
+	return in->good();
+}
+
+/*
+ * Reads the payload of h into payload. The length comes from the stream,
+ * so the payload is grown FRAME_READ_CHUNK bytes at a time as they
+ * arrive, and a corrupt length costs no more memory than the stream
+ * actually holds.
+ *
+ * Returns false if the stream ends before the payload does.
+ */
+bool ArFrameReader::readPayload(const ArFrameHeader& h, std::string* payload){
+	payload->clear();
+	while (payload->size() < h.length){
+		size_t done = payload->size();
+		size_t n = h.length - done < FRAME_READ_CHUNK ? h.length - done : FRAME_READ_CHUNK;
+		payload->resize(done + n);
+		in->read(&(*payload)[done], n);
+		if (!in->good()){
+			payload->resize(done + in->gcount());
+			return false;
+		}
+	}
+	return in->good();
+}
+
+/*
+ * Decodes the payload of a frame into dst, which must have room for
+ * h.symbols characters. m is only used by ENGINE_STATIC frames.
+ *
+ * This touches nothing but its arguments, so separate frames may be
+ * decoded on separate threads, as long as a shared m has already been
+ * digested.
+ *
+ * Returns false if the engine is not known, m is missing, or the payload
+ * ends before the symbols do.
+ */
+bool ArFrameReader::decodeFrame(Model* m, const ArFrameHeader& h, const std::string& payload, uint8_t* dst){
+	return decodeFrame(m, NULL, h, payload, dst);
+}
+
+/*
+ * As above, with reg giving the Models of ENGINE_REGISTERED frames.
+ * Returns false if such a frame names a Model that reg does not have.
+ */
+bool ArFrameReader::decodeFrame(Model* m, ModelRegistry* reg, const ArFrameHeader& h, const std::string& payload, uint8_t* dst){
+	std::istringstream iss(payload);
+
+	if (h.engine == ENGINE_STATIC){
+		if (m == NULL){
+			return false;
+		}
+
+		ArDecoder ard(m, &iss);
+		ard.get(dst, h.symbols);
+		return !(ard.getFlags() & STREAM_NOT_GOOD);
+	}
+
+	if (h.engine == ENGINE_ADAPTIVE){
+		Model local;
+		local.flatten();
+
+		ArDecoder ard(&local, &iss);
+		for (uint32_t i = 0; i < h.symbols; i++){
+			dst[i] = ard.get();
+			local.update(dst[i]);
+		}
+		return !(ard.getFlags() & STREAM_NOT_GOOD);
+	}
+
+	if (h.engine == ENGINE_REGISTERED){
+		uint32_t id = 0;
+		iss.read((char*) &id, sizeof(id));
+		int index = reg != NULL ? reg->find(id) : -1;
+		if (index < 0){
+			return false;
+		}
+
+		ArDecoder ard(reg->getModel(index), &iss);
+		ard.get(dst, h.symbols);
+		return !(ard.getFlags() & STREAM_NOT_GOOD);
+	}
+
+	if (h.engine == ENGINE_HUFFMAN){
+		if (h.symbols == 0){
+			return true;
+		}
+
+		HuffmanCoder hc;
+		if (payload.size() < (size_t) HUFF_LENGTHS_SIZE || !hc.setLengths((const uint8_t*) payload.data())){
+			return false;
+		}
+		return hc.decode((const uint8_t*) payload.data() + HUFF_LENGTHS_SIZE, payload.size() - HUFF_LENGTHS_SIZE, dst, h.symbols) == h.symbols;
+	}
+
+	if (h.engine == ENGINE_DEFERRED){
+		uint32_t interval = 0;
+		iss.read((char*) &interval, sizeof(interval));
+		if (interval < 1 || interval > FRAME_MAX_INTERVAL){
+			return false;
+		}
+
+		Model local;
+		local.flatten();
+
+		ArDecoder ard(&local, &iss);
+		for (uint32_t i = 0; i < h.symbols; i += interval){
+			uint32_t n = h.symbols - i < interval ? h.symbols - i : interval;
+			ard.get(dst + i, n);
+			foldUpdates(&local, dst + i, n);
+		}
+		return !(ard.getFlags() & STREAM_NOT_GOOD);
+	}
+
+	if (h.engine == ENGINE_MIX){
+		int bits = iss.get();
+		if (bits < MIX_MIN_BITS || bits > MIX_MAX_BITS){
+			return false;
+		}
+
+		MixDecoder mxd(&iss, bits);
+		mxd.get(dst, h.symbols);
+		return !(mxd.getFlags() & STREAM_NOT_GOOD);
+	}
+
+	if (h.engine == ENGINE_STORED){
+		if (payload.size() != h.symbols){
+			return false;
+		}
+
+		memcpy(dst, payload.data(), h.symbols);
+		return true;
+	}
+
+	if (h.engine == ENGINE_LZ77){
+		LzDecoder lzd(&iss);
+		return lzd.get(dst, h.symbols) == h.symbols && !(lzd.getFlags() & STREAM_NOT_GOOD);
+	}
+
+	if (h.engine == ENGINE_BWT){
+		BwtDecoder bwd(&iss);
+		return bwd.get(dst, h.symbols) == h.symbols && !(bwd.getFlags() & STREAM_NOT_GOOD);
+	}
+
+	return false;
+}
@@ -0,0 +1,107 @@
+#ifndef ARFRAME_INCLUDED
+#define ARFRAME_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+class Model;
+class ModelRegistry;
+
+/*
+ * Framed stream format
+ *
+ * Stream header:	'A' 'r' 'C' <version>
+ * Each frame:		<engine> <symbols> <length> <payload>
+ * End of stream:	ENGINE_END
+ *
+ * engine is one byte, symbols and length are 32 bit values, and
+ * payload is length bytes of coder output. Since every frame carries
+ * its own symbol count and length, frames can be decoded with a plain
+ * counted loop, skipped without decoding, or handed off whole.
+ */
+
+const uint8_t FRAME_VERSION = 1;
+const size_t FRAME_READ_CHUNK = 0x1 << 20;	// Payload bytes read at a time, so corrupt lengths cannot allocate much
+
+// Symbols between Model updates in ENGINE_DEFERRED frames
+const uint32_t FRAME_DEFAULT_INTERVAL = 256;
+const uint32_t FRAME_MAX_INTERVAL = 0x1 << 24;
+
+// Incompressible block detection
+const uint32_t FRAME_SAMPLE_SIZE = 8192;	// Characters sampled, in FRAME_SAMPLE_SPANS even spans
+const uint32_t FRAME_SAMPLE_SPANS = 16;
+const double FRAME_STORED_BITS = 7.9;		// Estimated bits per character at which a block is stored
+
+// Engines
+const uint8_t ENGINE_STATIC		= 0x0;	// Model supplied by the application, never modified
+const uint8_t ENGINE_ADAPTIVE	= 0x1;	// Flat Model at frame start, updated after every symbol
+const uint8_t ENGINE_LZ77		= 0x2;	// One LzEncoder block
+const uint8_t ENGINE_BWT		= 0x3;	// One BwtEncoder block
+const uint8_t ENGINE_REGISTERED	= 0x4;	// A 32 bit ModelRegistry ID, then as ENGINE_STATIC with that Model
+const uint8_t ENGINE_HUFFMAN		= 0x5;	// HUFF_LENGTHS_SIZE bytes of code lengths, then HuffmanCoder output
+const uint8_t ENGINE_DEFERRED	= 0x6;	// A 32 bit interval, then as ENGINE_ADAPTIVE with updates folded in once per interval
+const uint8_t ENGINE_MIX		= 0x7;	// A byte of MixPredictor table bits, then MixEncoder output
+const uint8_t ENGINE_STORED		= 0x8;	// The characters themselves, uncoded
+const uint8_t ENGINE_END		= 0xFF;	// Marks the end of the stream; no symbols or length follow
+
+struct ArFrameHeader{
+	uint8_t engine;
+	uint32_t symbols;
+	uint32_t length;
+};
+
+class ArFrameWriter{
+public:
+	ArFrameWriter(std::ostream* out);
+	~ArFrameWriter();
+
+	bool putStreamHeader();
+	bool putFrame(Model* m, const uint8_t* src, uint32_t count);
+	bool putAdaptiveFrame(const uint8_t* src, uint32_t count);
+	bool putDeferredFrame(const uint8_t* src, uint32_t count, uint32_t interval);
+	bool putLzFrame(const uint8_t* src, uint32_t count, int level);
+	bool putBwtFrame(const uint8_t* src, uint32_t count);
+	bool putMixFrame(const uint8_t* src, uint32_t count, int tableBits);
+	bool putRegisteredFrame(ModelRegistry* reg, const uint8_t* src, uint32_t count);
+	bool putHuffmanFrame(Model* m, const uint8_t* src, uint32_t count);
+	bool putStoredFrame(const uint8_t* src, uint32_t count);
+	bool putRawFrame(uint8_t engine, uint32_t symbols, const char* payload, uint32_t length);
+	bool finish();
+
+	void setBypass(bool on);
+	static bool isIncompressible(const uint8_t* src, uint32_t count);
+private:
+	std::ostream* out;
+	std::ostringstream scratch;
+	bool bypass;
+
+	bool putScratch(uint8_t engine, const uint8_t* src, uint32_t count);
+	bool putCoded(uint8_t engine, const uint8_t* src, uint32_t count, const char* payload, size_t length);
+};
+
+class ArFrameReader{
+public:
+	ArFrameReader(std::istream* in);
+	~ArFrameReader();
+
+	bool readStreamHeader();
+	uint8_t getVersion();
+
+	bool next(ArFrameHeader* h);
+	bool atEnd();
+	bool skip(const ArFrameHeader& h);
+	bool readPayload(const ArFrameHeader& h, std::string* payload);
+
+	static bool decodeFrame(Model* m, const ArFrameHeader& h, const std::string& payload, uint8_t* dst);
+	static bool decodeFrame(Model* m, ModelRegistry* reg, const ArFrameHeader& h, const std::string& payload, uint8_t* dst);
+private:
+	std::istream* in;
+	uint8_t version;
+	bool ended;
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "ArLog.h"
+
+#include <string.h>
+
+const char LOG_MAGIC[4] = {'A', 'r', 'L', 'g'};
+
+/*
+ * Creates a writer for file, which must be opened for both reading and
+ * writing, in binary mode. Nothing happens until open() is called.
+ */
+ArLogWriter::ArLogWriter(std::iostream* logfile) : are(&m, &pending){
+	file = logfile;
+	symbols = 0;
+	streamEnd = 0;
+	fileEnd = 0;
+	opened = false;
+}
+
+ArLogWriter::~ArLogWriter(){}
+
+/*
+ * Starts a new log if the file is empty, or restores the state in the
+ * trailer of an existing log so that put() carries on its stream.
+ *
+ * Returns false, and refuses to write, if file is NULL, cannot be read,
+ * or holds something other than a log.
+ */
+bool ArLogWriter::open(){
+	opened = false;
+	if (file == NULL){
+		return false;
+	}
+
+	file->clear();
+	file->seekg(0, std::ios::end);
+	std::streamoff size = file->tellg();
+	if (size < 0){
+		return false;
+	}
+
+	m.flatten();
+	pending.str("");
+	are.reset(&m, &pending);
+	symbols = 0;
+	streamEnd = 0;
+	fileEnd = size;
+
+	if (size == 0){
+		opened = true;
+		return opened;
+	}
+	if ((uint64_t) size < LOG_TRAILER_SIZE){
+		return false;
+	}
+
+	file->seekg(size - LOG_TRAILER_SIZE);
+	if (!are.loadState(file)){
+		return false;
+	}
+
+	uint32_t counts[256];
+	uint64_t count, streamBytes;
+	char magic[sizeof(LOG_MAGIC)];
+	file->read((char*) counts, sizeof(counts));
+	file->read((char*) &count, sizeof(count));
+	file->read((char*) &streamBytes, sizeof(streamBytes));
+	file->read(magic, sizeof(magic));
+	if (!file->good() || memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0 || streamBytes > (uint64_t) size - LOG_TRAILER_SIZE){
+		return false;
+	}
+
+	// Every character keeps at least the slot it started with
+	m.reset();
+	for (int i = 0; i < 256; i++){
+		if (counts[i] == 0 || counts[i] > LOG_RESCALE_TOTAL || !m.update(i, counts[i])){
+			return false;
+		}
+	}
+
+	symbols = count;
+	streamEnd = streamBytes;
+	opened = true;
+	return opened;
+}
+
+/*
+ * Encodes count characters from src onto the end of the log, updating
+ * the Model after each one. They are held in memory, so they are not
+ * readable, and would be lost if the process ended, until the next
+ * checkpoint(). The file is not touched.
+ *
+ * Returns false if the log is not open.
+ */
+bool ArLogWriter::put(const uint8_t* src, size_t count){
+	if (!opened){
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++){
+		are.put(src[i]);
+		m.adapt(src[i], 1, LOG_RESCALE_TOTAL);
+	}
+	symbols += count;
+
+	return true;
+}
+
+/*
+ * Makes the log complete as it stands: writes what put() has encoded
+ * since the last checkpoint over the old tail, then the tail that
+ * finishes the stream so far and the trailer, and flushes the file. The
+ * encoder is left as it was, so put() can carry on, and the next
+ * checkpoint writes over this one's tail and trailer. A writer must
+ * checkpoint before the file is closed.
+ *
+ * Returns false if the log is not open or the file is not good.
+ */
+bool ArLogWriter::checkpoint(){
+	if (!opened){
+		return false;
+	}
+
+	// Only whole words of the stream have been encoded; the rest is in
+	// the encoder's state
+	size_t words = pending.str().size();
+	uint64_t bytes = streamEnd + words;
+
+	// Finish a copy, so that the encoder itself is not finished, and take
+	// its tail back out of pending
+	ArEncoder tail = are;
+	tail.finish();
+	std::string out = pending.str();
+	pending.str("");
+	pending.write(out.data(), words);
+
+	file->seekp(streamEnd);
+	file->write(out.data(), out.size());
+
+	uint64_t end = streamEnd + out.size() + LOG_TRAILER_SIZE;
+	while (end < fileEnd){
+		file->put(0);
+		end++;
+	}
+
+	uint32_t counts[256];
+	for (int i = 0; i < 256; i++){
+		counts[i] = m.getCharCount(i);
+	}
+
+	are.saveState(file);
+	file->write((char*) counts, sizeof(counts));
+	file->write((char*) &symbols, sizeof(symbols));
+	file->write((char*) &bytes, sizeof(bytes));
+	file->write(LOG_MAGIC, sizeof(LOG_MAGIC));
+	file->flush();
+
+	if (!file->good()){
+		return false;
+	}
+
+	fileEnd = file->tellp();
+	streamEnd = bytes;
+	pending.str("");
+
+	return true;
+}
+
+/*
+ * The number of characters in the log, including any put() since the
+ * last checkpoint.
+ */
+uint64_t ArLogWriter::getSymbols(){
+	return symbols;
+}
+
+ArLogReader::ArLogReader(std::istream* logfile) : ard(NULL, NULL){
+	file = logfile;
+	symbols = 0;
+	remaining = 0;
+}
+
+ArLogReader::~ArLogReader(){}
+
+/*
+ * Reads the trailer, to find how many characters the log holds, and
+ * starts decoding from the beginning.
+ *
+ * Returns false if file is NULL, cannot be read, or is not a log.
+ */
+bool ArLogReader::open(){
+	symbols = remaining = 0;
+	if (file == NULL){
+		return false;
+	}
+
+	file->clear();
+	file->seekg(0, std::ios::end);
+	std::streamoff size = file->tellg();
+	if (size < (std::streamoff) LOG_TRAILER_SIZE){
+		return false;
+	}
+
+	uint64_t count, streamBytes;
+	char magic[sizeof(LOG_MAGIC)];
+	file->seekg(size - LOG_TRAILER_SIZE + ENCODER_STATE_SIZE + 256 * 4);
+	file->read((char*) &count, sizeof(count));
+	file->read((char*) &streamBytes, sizeof(streamBytes));
+	file->read(magic, sizeof(magic));
+	if (!file->good() || memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0){
+		return false;
+	}
+
+	m.flatten();
+	file->seekg(0);
+	ard.reset(&m, file);
+
+	symbols = remaining = count;
+	return true;
+}
+
+/*
+ * Decodes up to count of the log's characters into dst, carrying on from
+ * the last call.
+ *
+ * Returns the number decoded, which is 0 once the log has been read.
+ */
+size_t ArLogReader::get(uint8_t* dst, size_t count){
+	size_t n = remaining < count ? remaining : count;
+	for (size_t i = 0; i < n; i++){
+		dst[i] = ard.get();
+		m.adapt(dst[i], 1, LOG_RESCALE_TOTAL);
+	}
+	remaining -= n;
+
+	return n;
+}
+
+uint64_t ArLogReader::getSymbols(){
+	return symbols;
+}
+
+uint64_t ArLogReader::getRemaining(){
+	return remaining;
+}
@@ -0,0 +1,79 @@
+#ifndef ARLOG_INCLUDED
+#define ARLOG_INCLUDED
+
+#include <iostream>
+#include <sstream>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Model.h"
+#include "ArEncoder.h"
+#include "ArDecoder.h"
+
+/*
+ * Appendable compressed logs
+ *
+ * A log is one adaptive stream that any number of writers can add to in
+ * turn, each picking up where the last left off, so the Model never has
+ * to learn the data again:
+ *
+ *		<stream> <tail> <padding> <trailer>
+ *
+ * The tail is what ArEncoder::finish() would write, so that a reader can
+ * decode everything up to the trailer. The trailer holds everything a
+ * writer needs to carry on instead: the encoder's state, the Model's
+ * counts, the number of characters, and where the stream stops. The next
+ * writer restores these and writes over the tail and trailer.
+ *
+ * The trailer is always the last LOG_TRAILER_SIZE bytes, and a file never
+ * gets shorter, so the padding makes up any difference between an old
+ * trailer's end and a new one's.
+ *
+ * A writer holds what it encodes in memory and only touches the file in
+ * checkpoint(), so a process that dies between checkpoints leaves the
+ * log as the last one wrote it. Only dying during a checkpoint, while
+ * the old tail and trailer are being written over, can leave a log that
+ * open() rejects.
+ */
+
+const uint32_t LOG_RESCALE_TOTAL = 0x1 << 24;	// The Model is halved before its total passes this
+const size_t LOG_TRAILER_SIZE = ENCODER_STATE_SIZE + 256 * 4 + 8 + 8 + 4;
+
+class ArLogWriter{
+public:
+	ArLogWriter(std::iostream* file);
+	~ArLogWriter();
+
+	bool open();
+	bool put(const uint8_t* src, size_t count);
+	bool checkpoint();
+	uint64_t getSymbols();
+private:
+	std::iostream* file;
+	Model m;
+	std::ostringstream pending;	// Encoded since the last checkpoint
+	ArEncoder are;
+	uint64_t symbols;
+	uint64_t streamEnd;		// Where the stream's whole words in the file stop
+	uint64_t fileEnd;		// Where the last trailer ended, which the next must reach
+	bool opened;
+};
+
+class ArLogReader{
+public:
+	ArLogReader(std::istream* file);
+	~ArLogReader();
+
+	bool open();
+	size_t get(uint8_t* dst, size_t count);
+	uint64_t getSymbols();
+	uint64_t getRemaining();
+private:
+	std::istream* file;
+	Model m;
+	ArDecoder ard;
+	uint64_t symbols;
+	uint64_t remaining;
+};
+
+#endif
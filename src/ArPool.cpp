@@ -0,0 +1,208 @@
+#include "ArPool.h"
+#include "Model.h"
+#include "CompactModel.h"
+#include "ArEncoder.h"
+#include "ArDecoder.h"
+#include "ArPushEncoder.h"
+#include "ArPushDecoder.h"
+
+#include <new>
+
+// Builds an idle object in raw memory, for each kind the pool holds
+static void construct(Model* p){ new (p) Model(); }
+static void construct(CompactModel* p){ new (p) CompactModel(); }
+static void construct(ArEncoder* p){ new (p) ArEncoder(NULL, NULL); }
+static void construct(ArDecoder* p){ new (p) ArDecoder(NULL, NULL); }
+static void construct(ArPushEncoder* p){ new (p) ArPushEncoder(NULL); }
+static void construct(ArPushDecoder* p){ new (p) ArPushDecoder(NULL); }
+
+/*
+ * Creates an empty pool. Whenever it runs out of objects of a kind, it
+ * allocates chunk more (at least 1).
+ */
+ArPool::ArPool(size_t size){
+	chunk = size ? size : 1;
+	allocations = 0;
+}
+
+/*
+ * Destroys every object that came from the pool, released or not.
+ */
+ArPool::~ArPool(){
+	destroy(models);
+	destroy(compactModels);
+	destroy(encoders);
+	destroy(decoders);
+	destroy(pushEncoders);
+	destroy(pushDecoders);
+}
+
+/*
+ * An empty Model.
+ */
+Model* ArPool::getModel(){
+	Model* m = take(models);
+	m->reset();
+	return m;
+}
+
+/*
+ * A copy of from, such as a shared starting Model for adaptive coding.
+ * The copy costs no more than the 1 KB of counts.
+ */
+Model* ArPool::getModel(const Model* from){
+	Model* m = take(models);
+	*m = *from;
+	return m;
+}
+
+/*
+ * An empty CompactModel. See CompactModel::CompactModel().
+ */
+CompactModel* ArPool::getCompactModel(bool sorted){
+	CompactModel* cm = take(compactModels);
+	*cm = CompactModel(sorted);
+	return cm;
+}
+
+/*
+ * An encoder for a new stream, as from ArEncoder::ArEncoder().
+ */
+ArEncoder* ArPool::getEncoder(Model* m, std::ostream* out){
+	ArEncoder* are = take(encoders);
+	are->reset(m, out);
+	return are;
+}
+
+/*
+ * A decoder for a new stream, as from ArDecoder::ArDecoder(). It reads
+ * the first 32 bits of in straight away.
+ */
+ArDecoder* ArPool::getDecoder(Model* m, std::istream* in){
+	ArDecoder* ard = take(decoders);
+	ard->reset(m, in);
+	return ard;
+}
+
+ArPushEncoder* ArPool::getPushEncoder(Model* m){
+	ArPushEncoder* ape = take(pushEncoders);
+	ape->reset(m);
+	return ape;
+}
+
+ArPushDecoder* ArPool::getPushDecoder(Model* m){
+	ArPushDecoder* apd = take(pushDecoders);
+	apd->reset(m);
+	return apd;
+}
+
+/*
+ * Hands an object back to the pool, which may give it out again on the
+ * next get. It must have come from this pool and not be used again.
+ * Releasing NULL does nothing.
+ */
+void ArPool::release(Model* m){
+	give(models, m);
+}
+
+void ArPool::release(CompactModel* cm){
+	give(compactModels, cm);
+}
+
+void ArPool::release(ArEncoder* are){
+	give(encoders, are);
+}
+
+void ArPool::release(ArDecoder* ard){
+	give(decoders, ard);
+}
+
+void ArPool::release(ArPushEncoder* ape){
+	give(pushEncoders, ape);
+}
+
+void ArPool::release(ArPushDecoder* apd){
+	give(pushDecoders, apd);
+}
+
+/*
+ * Makes sure that at least models Models and CompactModels, and coders
+ * coders of each kind, can be out at once without allocating, so that
+ * a thread can do all of its allocation up front.
+ */
+void ArPool::reserve(size_t modelCount, size_t coderCount){
+	if (models.total < modelCount){
+		grow(models, modelCount - models.total);
+	}
+	if (compactModels.total < modelCount){
+		grow(compactModels, modelCount - compactModels.total);
+	}
+	if (encoders.total < coderCount){
+		grow(encoders, coderCount - encoders.total);
+	}
+	if (decoders.total < coderCount){
+		grow(decoders, coderCount - decoders.total);
+	}
+	if (pushEncoders.total < coderCount){
+		grow(pushEncoders, coderCount - pushEncoders.total);
+	}
+	if (pushDecoders.total < coderCount){
+		grow(pushDecoders, coderCount - pushDecoders.total);
+	}
+}
+
+/*
+ * The number of chunks allocated so far. It stops rising once the pool
+ * has warmed up, which makes it easy to check that a loop does not
+ * allocate.
+ */
+size_t ArPool::getAllocations(){
+	return allocations;
+}
+
+template <class T> T* ArPool::take(PoolSlab<T>& slab){
+	if (slab.free.empty()){
+		grow(slab, chunk);
+	}
+
+	T* t = slab.free.back();
+	slab.free.pop_back();
+	return t;
+}
+
+template <class T> void ArPool::give(PoolSlab<T>& slab, T* t){
+	if (t != NULL){
+		slab.free.push_back(t);
+	}
+}
+
+/*
+ * Allocates count more objects in one chunk, and makes room in the free
+ * list for all of them at once.
+ */
+template <class T> void ArPool::grow(PoolSlab<T>& slab, size_t count){
+	T* block = static_cast<T*>(::operator new(count * sizeof(T)));
+	for (size_t i = 0; i < count; i++){
+		construct(block + i);
+	}
+
+	slab.chunks.push_back(std::make_pair(block, count));
+	slab.total += count;
+	slab.free.reserve(slab.total);
+	for (size_t i = count; i > 0; i--){
+		slab.free.push_back(block + i - 1);
+	}
+	allocations++;
+}
+
+template <class T> void ArPool::destroy(PoolSlab<T>& slab){
+	for (size_t c = 0; c < slab.chunks.size(); c++){
+		for (size_t i = 0; i < slab.chunks[c].second; i++){
+			slab.chunks[c].first[i].~T();
+		}
+		::operator delete(slab.chunks[c].first);
+	}
+	slab.chunks.clear();
+	slab.free.clear();
+	slab.total = 0;
+}
@@ -0,0 +1,91 @@
+#ifndef ARPOOL_INCLUDED
+#define ARPOOL_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class Model;
+class CompactModel;
+class ArEncoder;
+class ArDecoder;
+class ArPushEncoder;
+class ArPushDecoder;
+
+const size_t POOL_DEFAULT_CHUNK = 64;	// Objects of a kind allocated together when a pool runs out
+
+/*
+ * Objects of one kind, allocated POOL_DEFAULT_CHUNK or so at a time and
+ * never freed until the pool is destroyed. The free list always has room
+ * for every object, so putting one back never allocates.
+ */
+template <class T> struct PoolSlab{
+	std::vector<T*> free;
+	std::vector<std::pair<T*, size_t> > chunks;	// Each chunk and its size
+	size_t total;
+
+	PoolSlab() : total(0){}
+};
+
+/*
+ * A per thread store of Models and coders, for workloads that code many
+ * small messages, each with a fresh coder and often a fresh Model.
+ *
+ * Objects are allocated in chunks the first time they are needed, and
+ * after that are handed out again once they are released, reset as if
+ * they were new. Once a pool has grown to the most objects in use at one
+ * time, coding takes no heap allocations at all. With ArPushEncoder and
+ * ArPushDecoder, which work on caller provided buffers, this holds for
+ * the whole path; ArEncoder and ArDecoder allocate whatever their streams
+ * do.
+ *
+ * A pool is not synchronized. Give each thread its own, and release
+ * objects to the pool they came from.
+ */
+class ArPool{
+public:
+	ArPool(size_t chunk = POOL_DEFAULT_CHUNK);
+	~ArPool();
+
+	Model* getModel();
+	Model* getModel(const Model* from);
+	CompactModel* getCompactModel(bool sorted = true);
+	ArEncoder* getEncoder(Model* m, std::ostream* out);
+	ArDecoder* getDecoder(Model* m, std::istream* in);
+	ArPushEncoder* getPushEncoder(Model* m);
+	ArPushDecoder* getPushDecoder(Model* m);
+
+	void release(Model* m);
+	void release(CompactModel* cm);
+	void release(ArEncoder* are);
+	void release(ArDecoder* ard);
+	void release(ArPushEncoder* ape);
+	void release(ArPushDecoder* apd);
+
+	void reserve(size_t models, size_t coders);
+	size_t getAllocations();
+private:
+	size_t chunk;
+	size_t allocations;
+
+	PoolSlab<Model> models;
+	PoolSlab<CompactModel> compactModels;
+	PoolSlab<ArEncoder> encoders;
+	PoolSlab<ArDecoder> decoders;
+	PoolSlab<ArPushEncoder> pushEncoders;
+	PoolSlab<ArPushDecoder> pushDecoders;
+
+	// Not copyable, since the objects belong to one pool
+	ArPool(const ArPool&);
+	ArPool& operator=(const ArPool&);
+
+	template <class T> T* take(PoolSlab<T>& slab);
+	template <class T> void give(PoolSlab<T>& slab, T* t);
+	template <class T> void grow(PoolSlab<T>& slab, size_t count);
+	template <class T> void destroy(PoolSlab<T>& slab);
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "ArPushDecoder.h"
+#include "Model.h"
+
+#include <string.h>
+
+ArPushDecoder::ArPushDecoder(Model* model){
+	reset(model);
+}
+
+ArPushDecoder::~ArPushDecoder(){}
+
+/*
+ * Starts a new stream with model, exactly as if the decoder had just
+ * been constructed. Any input still fed in is forgotten.
+ */
+void ArPushDecoder::reset(Model* model){
+	m = model;
+
+	next = NULL;
+	left = 0;
+	ended = false;
+	primed = false;
+
+	flags = 0;
+	if (m == NULL){
+		flags |= MODEL_NULL;
+	}
+
+	partLen = 0;
+	res = 0;
+	resBits = 0;
+
+	top = ~0;
+	bot = 0;
+	cur = 0;
+}
+
+/*
+ * Hands the decoder the next chunk of input. The chunk is not copied,
+ * so it must stay valid until get() reports that it needs more input.
+ *
+ * Should only be called once the previous chunk has been consumed
+ * (avail() is 0).
+ */
+void ArPushDecoder::feed(const uint8_t* data, size_t len){
+	next = data;
+	left = len;
+}
+
+/*
+ * Marks the end of the input. Any bits needed past the end are read
+ * as 0s and STREAM_NOT_GOOD is set, just like ArDecoder.
+ */
+void ArPushDecoder::finish(){
+	ended = true;
+}
+
+/*
+ * Decodes a single character into c.
+ *
+ * Returns false without changing any state if more input is needed
+ * (or the Model is NULL). In that case, the whole of the last chunk
+ * has been consumed.
+ */
+bool ArPushDecoder::get(uint8_t* c){
+	if (flags & MODEL_NULL){
+		return false;
+	}
+
+	// The first 32 bits make up the initial value of cur
+	if (!primed){
+		if (!fill(sizeof(cur) * 8)){
+			return false;
+		}
+		cur = take(sizeof(cur) * 8);
+		primed = true;
+	}
+
+	uint8_t sym = m->getChar(cur, bot, top);
+	uint32_t t = m->calcUpper(sym, bot, top);
+	uint32_t b = m->calcLower(sym, bot, top);
+
+	// Widen a copy of the interval, to count the bits it will read
+	// without committing, as ArDecoderCore does
+	int first = settledBits(t, b);
+	dropSettled(&t, &b, first);
+	int second = dropStraddled(&t, &b);
+
+	if (!fill(first + second)){
+		return false;
+	}
+
+	top = t;
+	bot = b;
+	if (first > 0){
+		cur = (cur << first) | take(first);
+	}
+	for (int i = 0; i < second; i++){
+		cur <<= 1;
+		cur ^= (uint32_t) 0x1 << (sizeof(cur) * 8 - 1);
+		cur |= take(1);
+	}
+
+	*c = sym;
+	return true;
+}
+
+/*
+ * Decodes up to count characters into dst.
+ * Returns the number decoded, which is less than count only when more
+ * input is needed.
+ */
+size_t ArPushDecoder::get(uint8_t* dst, size_t count){
+	size_t i = 0;
+	while (i < count && get(dst + i)){
+		i++;
+	}
+	return i;
+}
+
+/*
+ * The number of bytes of the last chunk that have not been consumed.
+ */
+size_t ArPushDecoder::avail(){
+	return left;
+}
+
+/*
+ * Returns the internal flags. See ArDecoder::getFlags().
+ */
+uint8_t ArPushDecoder::getFlags(){
+	return flags;
+}
+
+/*
+ * Moves input into the lookahead until it holds at least count bits
+ * (count may not exceed 32). Input is moved one 32 bit word at a time,
+ * matching the words written by ArEncoder.
+ *
+ * Returns false if the input ran out first, unless the end of the
+ * input has been marked.
+ */
+inline bool ArPushDecoder::fill(int count){
+	while (resBits < count){
+		while (partLen < 4 && left > 0){
+			part[partLen++] = *next++;
+			left--;
+		}
+
+		if (partLen < 4){
+			return ended;
+		}
+
+		uint32_t word;
+		memcpy(&word, part, sizeof(word));
+		res = (res << 32) | word;
+		resBits += 32;
+		partLen = 0;
+	}
+
+	return true;
+}
+
+/*
+ * Takes count bits from the lookahead (1 to 32 bits). Missing bits are
+ * read as 0s and flagged.
+ */
+inline uint32_t ArPushDecoder::take(int count){
+	uint32_t bits;
+	if (resBits >= count){
+		resBits -= count;
+		bits = res >> resBits;
+	} else{
+		flags |= STREAM_NOT_GOOD;
+		bits = res << (count - resBits);
+		resBits = 0;
+	}
+
+	return bits & (uint32_t) (((uint64_t) 1 << count) - 1);
+}
@@ -0,0 +1,56 @@
+#ifndef ARPUSHDE_INCLUDED
+#define ARPUSHDE_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ArCore.h"	// Flags
+
+class Model;
+
+/*
+ * A decoder that is fed input rather than reading it, for use with
+ * non-blocking sources. Input chunks are read in place; at most three
+ * bytes of a partial word and 64 bits of lookahead are kept between
+ * chunks.
+ *
+ * A character is only produced once all the bits it needs are present,
+ * so get() can fail at any point and be retried after the next feed()
+ * without losing state.
+ */
+class ArPushDecoder{
+public:
+	ArPushDecoder(Model* m);
+	~ArPushDecoder();
+
+	void reset(Model* m);
+	void feed(const uint8_t* data, size_t len);
+	void finish();
+
+	bool get(uint8_t* c);
+	size_t get(uint8_t* dst, size_t count);
+
+	size_t avail();
+	uint8_t getFlags();
+private:
+	Model* m;
+	const uint8_t* next;
+	size_t left;
+	bool ended;
+	bool primed;
+	uint8_t flags;
+
+	uint8_t part[4];
+	int partLen;
+	uint64_t res;
+	int resBits;
+
+	uint32_t top;
+	uint32_t bot;
+	uint32_t cur;
+
+	inline bool fill(int count);
+	inline uint32_t take(int count);
+};
+
+#endif
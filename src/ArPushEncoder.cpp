@@ -0,0 +1,221 @@
+#include "ArPushEncoder.h"
+#include "Model.h"
+#include "ArCore.h"
+
+#include <string.h>
+
+ArPushEncoder::ArPushEncoder(Model* model){
+	reset(model);
+}
+
+ArPushEncoder::~ArPushEncoder(){}
+
+/*
+ * Starts a new stream with model, exactly as if the encoder had just
+ * been constructed. Anything held back is dropped, and the output buffer
+ * must be set again.
+ */
+void ArPushEncoder::reset(Model* model){
+	m = model;
+
+	out = NULL;
+	avail = 0;
+	written = 0;
+
+	buf = 0;
+	bufcurs = sizeof(buf) * 8 - 1;
+	pending = 0;
+
+	top = ~0;
+	bot = 0;
+
+	headCount = 0;
+	head = 0;
+	runLeft = 0;
+	runBit = 0;
+	tailCount = 0;
+	tail = 0;
+	finishing = false;
+}
+
+/*
+ * Points the encoder at a new output buffer. The buffer is written in
+ * place. Anything held back from the previous buffer is written first.
+ */
+void ArPushEncoder::setOutput(uint8_t* dst, size_t cap){
+	out = dst;
+	avail = cap;
+	written = 0;
+}
+
+/*
+ * The number of bytes written into the current output buffer.
+ */
+size_t ArPushEncoder::produced(){
+	return written;
+}
+
+/*
+ * Encodes a character.
+ *
+ * Returns false without encoding c if the bits of an earlier character
+ * still do not fit in the output (or the Model is NULL). In that case,
+ * call setOutput() and put c again.
+ */
+bool ArPushEncoder::put(uint8_t c){
+	if (m == NULL || finishing || !drain()){
+		return false;
+	}
+
+	uint32_t tmp = top;
+	top = m->calcUpper(c, bot, top);
+	bot = m->calcLower(c, bot, tmp);
+
+	// Hold the settled bits, with the pending bits after the first, as
+	// ArEncoderCore outputs them
+	int count = settledBits(top, bot);
+	if (count > 0){
+		head = top >> (sizeof(top) * 8 - 1);
+		headCount = 1;
+		runBit = ~head & 0x1;
+		runLeft = pending;
+		pending = 0;
+		tail = top >> (sizeof(top) * 8 - count);
+		tailCount = count - 1;
+
+		dropSettled(&top, &bot, count);
+	}
+
+	pending += dropStraddled(&top, &bot);
+
+	drain();
+
+	return true;
+}
+
+/*
+ * Encodes up to count characters from src.
+ * Returns the number encoded, which is less than count only when the
+ * output buffer is full.
+ */
+size_t ArPushEncoder::put(const uint8_t* src, size_t count){
+	size_t i = 0;
+	while (i < count && put(src[i])){
+		i++;
+	}
+	return i;
+}
+
+/*
+ * Writes out bot and all pending bits, like ArEncoder::finish().
+ *
+ * Returns false if the output buffer filled up first. In that case,
+ * call setOutput() and finish() again. No characters may be put after
+ * finish() has been called.
+ */
+bool ArPushEncoder::finish(){
+	if (!finishing){
+		if (!drain()){
+			return false;
+		}
+
+		// First bit of bot is always 0, then the pending bits, then the rest of bot
+		head = 0;
+		headCount = 1;
+		runBit = 1;
+		runLeft = pending;
+		pending = 0;
+		tail = bot;
+		tailCount = sizeof(bot) * 8 - 1;
+		finishing = true;
+	}
+
+	if (!drain()){
+		return false;
+	}
+
+	// Write out the partially filled word
+	if (bufcurs < (int) sizeof(buf) * 8 - 1){
+		bufcurs = -1;
+		return flushWord();
+	}
+
+	return true;
+}
+
+/*
+ * Writes out as much of the held back bits as fits.
+ * Returns true once nothing but a partial word remains.
+ */
+inline bool ArPushEncoder::drain(){
+	if (headCount > 0){
+		if (pushBits(head, 1) < 1){
+			return false;
+		}
+		headCount = 0;
+	}
+
+	while (runLeft > 0){
+		int n = runLeft < 32 ? runLeft : 32;
+		int taken = pushBits(runBit ? ~(uint32_t) 0 : 0, n);
+		runLeft -= taken;
+		if (taken < n){
+			return false;
+		}
+	}
+
+	if (tailCount > 0){
+		tailCount -= pushBits(tail, tailCount);
+		if (tailCount > 0){
+			return false;
+		}
+	}
+
+	return bufcurs >= 0 || flushWord();
+}
+
+/*
+ * Moves the rightmost count bits of bits (1 to 32) into buf, most
+ * significant first, writing each word as it fills.
+ *
+ * Returns the number of bits moved, which is less than count only if
+ * a full word could not be written.
+ */
+inline int ArPushEncoder::pushBits(uint32_t bits, int count){
+	int taken = 0;
+	while (taken < count){
+		if (bufcurs < 0 && !flushWord()){
+			break;
+		}
+
+		int fit = (bufcurs + 1 < count - taken) ? bufcurs + 1 : count - taken;
+		uint32_t chunk = (uint32_t) ((bits >> (count - taken - fit)) & (((uint64_t) 1 << fit) - 1));
+		buf |= (uint32_t) ((uint64_t) chunk << (bufcurs - fit + 1));
+		bufcurs -= fit;
+		taken += fit;
+	}
+
+	if (bufcurs < 0){
+		flushWord();
+	}
+
+	return taken;
+}
+
+/*
+ * Writes the full word in buf, if there is room for it.
+ */
+inline bool ArPushEncoder::flushWord(){
+	if (avail < sizeof(buf)){
+		return false;
+	}
+
+	memcpy(out + written, &buf, sizeof(buf));
+	written += sizeof(buf);
+	avail -= sizeof(buf);
+
+	buf = 0;
+	bufcurs = sizeof(buf) * 8 - 1;
+
+	return true;
+}
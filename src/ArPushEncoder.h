@@ -0,0 +1,56 @@
+#ifndef ARPUSHEN_INCLUDED
+#define ARPUSHEN_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Model;
+
+/*
+ * An encoder that writes into caller provided buffers rather than a
+ * stream, for use with non-blocking sinks. Its output is byte for byte
+ * the same as ArEncoder's.
+ *
+ * When the output buffer fills up, the encoder holds on to the bits of
+ * at most one character and refuses further characters until it is
+ * given more room.
+ */
+class ArPushEncoder{
+public:
+	ArPushEncoder(Model* m);
+	~ArPushEncoder();
+
+	void reset(Model* m);
+	void setOutput(uint8_t* dst, size_t cap);
+	size_t produced();
+
+	bool put(uint8_t c);
+	size_t put(const uint8_t* src, size_t count);
+	bool finish();
+private:
+	Model* m;
+	uint8_t* out;
+	size_t avail;
+	size_t written;
+
+	uint32_t buf;
+	int bufcurs;
+	int pending;
+	uint32_t top;
+	uint32_t bot;
+
+	// Bits that could not be written yet: head, then a run, then tail
+	int headCount;
+	uint8_t head;
+	int runLeft;
+	uint8_t runBit;
+	int tailCount;
+	uint32_t tail;
+	bool finishing;
+
+	inline bool drain();
+	inline int pushBits(uint32_t bits, int count);
+	inline bool flushWord();
+};
+
+#endif
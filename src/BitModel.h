@@ -0,0 +1,79 @@
+#ifndef BITMODEL_INCLUDED
+#define BITMODEL_INCLUDED
+
+#include <stdint.h>
+
+const int BIT_PROB_BITS = 16;		// Precision of the probability of a 0
+const int BIT_DEFAULT_SHIFT = 5;	// Adaptation rate: 1 / 2 ^ shift per bit
+
+/*
+ * An adaptive Model for a single binary decision, coded with
+ * ArEncoder::put(BitModel*, ...) and ArDecoder::get(BitModel*).
+ *
+ * Instead of counts, it holds the probability of a 0, which moves a
+ * fixed fraction of the way towards each bit it is updated with. It
+ * needs no digestion or rescaling, so a coder can keep thousands of them
+ * (one per context) and update them after every bit.
+ *
+ * The probability never reaches 0 or 1, so both bits can always be coded.
+ */
+class BitModel{
+public:
+	BitModel(){
+		reset();
+	}
+
+	/*
+	 * Moves the probability towards bit.
+	 */
+	inline void update(int bit, int shift = BIT_DEFAULT_SHIFT){
+		if (bit){
+			p0 -= p0 >> shift;
+		} else {
+			p0 += ((0x1 << BIT_PROB_BITS) - p0) >> shift;
+		}
+	}
+
+	inline uint32_t calcUpper(int bit, uint32_t bot, uint32_t top){
+		return bit ? top : split(bot, top) - 1;
+	}
+
+	inline uint32_t calcLower(int bit, uint32_t bot, uint32_t top){
+		return bit ? split(bot, top) : bot;
+	}
+
+	inline int getChar(uint32_t enc, uint32_t bot, uint32_t top){
+		return enc >= split(bot, top);
+	}
+
+	/*
+	 * The probability of a 0, out of 2 ^ BIT_PROB_BITS.
+	 */
+	inline uint32_t getProb(){
+		return p0;
+	}
+
+	/*
+	 * Sets the probability of a 0 from an outside estimate, such as a
+	 * mixer's. It is clamped so that both bits can still be coded.
+	 */
+	inline void setProb(uint32_t p){
+		const uint32_t one = 0x1 << BIT_PROB_BITS;
+		p0 = p < 1 ? 1 : (p >= one ? one - 1 : p);
+	}
+
+	inline void reset(){
+		p0 = 0x1 << (BIT_PROB_BITS - 1);
+	}
+
+private:
+	uint32_t p0;
+
+	// The first value coding a 1. The coders keep top - bot above 2 ^ 30,
+	// so both sides of it are always at least one value wide.
+	inline uint32_t split(uint32_t bot, uint32_t top){
+		return bot + (uint32_t) (((uint64_t) (top - bot) * p0) >> BIT_PROB_BITS) + 1;
+	}
+};
+
+#endif
@@ -0,0 +1,490 @@
+#include "Bwt.h"
+
+#include <chrono>
+
+// Rank Models learn faster than Model::adapt() does by default
+const int BWT_ADAPT_STEP = 32;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double secondsSince(Clock::time_point begin){
+	return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+/*
+ * Suffix array induced sorting (SA-IS), after Nong, Zhang, and Chan.
+ *
+ * Sorts the suffixes of s (n characters from an alphabet of 0 to K,
+ * ending in a unique 0) into SA in linear time.
+ */
+
+static void getBuckets(const int32_t* s, int32_t* bkt, int32_t n, int32_t K, bool end){
+	for (int32_t i = 0; i <= K; i++){
+		bkt[i] = 0;
+	}
+	for (int32_t i = 0; i < n; i++){
+		bkt[s[i]]++;
+	}
+
+	int32_t sum = 0;
+	for (int32_t i = 0; i <= K; i++){
+		sum += bkt[i];
+		bkt[i] = end ? sum : sum - bkt[i];
+	}
+}
+
+// Whether the suffix at i is the leftmost S-type suffix of its run
+#define IS_LMS(t, i)	((i) > 0 && (t)[i] && !(t)[(i) - 1])
+
+static void induceL(const std::vector<bool>& t, int32_t* SA, const int32_t* s, int32_t* bkt, int32_t n, int32_t K){
+	getBuckets(s, bkt, n, K, false);
+	for (int32_t i = 0; i < n; i++){
+		int32_t j = SA[i] - 1;
+		if (j >= 0 && !t[j]){
+			SA[bkt[s[j]]++] = j;
+		}
+	}
+}
+
+static void induceS(const std::vector<bool>& t, int32_t* SA, const int32_t* s, int32_t* bkt, int32_t n, int32_t K){
+	getBuckets(s, bkt, n, K, true);
+	for (int32_t i = n - 1; i >= 0; i--){
+		int32_t j = SA[i] - 1;
+		if (j >= 0 && t[j]){
+			SA[--bkt[s[j]]] = j;
+		}
+	}
+}
+
+static void sais(const int32_t* s, int32_t* SA, int32_t n, int32_t K){
+	// Classify each suffix as S-type (true) or L-type (false)
+	std::vector<bool> t(n);
+	t[n - 1] = true;
+	if (n > 1){
+		t[n - 2] = false;
+	}
+	for (int32_t i = n - 3; i >= 0; i--){
+		t[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && t[i + 1]);
+	}
+
+	// Sort the LMS substrings by induction
+	std::vector<int32_t> bkt(K + 1);
+	getBuckets(s, &bkt[0], n, K, true);
+	for (int32_t i = 0; i < n; i++){
+		SA[i] = -1;
+	}
+	for (int32_t i = 1; i < n; i++){
+		if (IS_LMS(t, i)){
+			SA[--bkt[s[i]]] = i;
+		}
+	}
+	induceL(t, SA, s, &bkt[0], n, K);
+	induceS(t, SA, s, &bkt[0], n, K);
+
+	// Move the sorted LMS substrings to the front
+	int32_t n1 = 0;
+	for (int32_t i = 0; i < n; i++){
+		if (IS_LMS(t, SA[i])){
+			SA[n1++] = SA[i];
+		}
+	}
+
+	// Name the LMS substrings, equal substrings getting equal names
+	for (int32_t i = n1; i < n; i++){
+		SA[i] = -1;
+	}
+	int32_t name = 0;
+	int32_t prev = -1;
+	for (int32_t i = 0; i < n1; i++){
+		int32_t pos = SA[i];
+		bool diff = false;
+		for (int32_t d = 0; d < n; d++){
+			if (prev == -1 || s[pos + d] != s[prev + d] || t[pos + d] != t[prev + d]){
+				diff = true;
+				break;
+			} else if (d > 0 && (IS_LMS(t, pos + d) || IS_LMS(t, prev + d))){
+				break;
+			}
+		}
+		if (diff){
+			name++;
+			prev = pos;
+		}
+		SA[n1 + pos / 2] = name - 1;
+	}
+	for (int32_t i = n - 1, j = n - 1; i >= n1; i--){
+		if (SA[i] >= 0){
+			SA[j--] = SA[i];
+		}
+	}
+
+	// Sort the reduced string, recursing if any names repeat
+	int32_t* s1 = SA + n - n1;
+	int32_t* SA1 = SA;
+	if (name < n1){
+		sais(s1, SA1, n1, name - 1);
+	} else{
+		for (int32_t i = 0; i < n1; i++){
+			SA1[s1[i]] = i;
+		}
+	}
+
+	// Induce the full order from the sorted LMS suffixes
+	getBuckets(s, &bkt[0], n, K, true);
+	for (int32_t i = 1, j = 0; i < n; i++){
+		if (IS_LMS(t, i)){
+			s1[j++] = i;
+		}
+	}
+	for (int32_t i = 0; i < n1; i++){
+		SA1[i] = s1[SA1[i]];
+	}
+	for (int32_t i = n1; i < n; i++){
+		SA[i] = -1;
+	}
+	for (int32_t i = n1 - 1; i >= 0; i--){
+		int32_t j = SA[i];
+		SA[i] = -1;
+		SA[--bkt[s[j]]] = j;
+	}
+	induceL(t, SA, s, &bkt[0], n, K);
+	induceS(t, SA, s, &bkt[0], n, K);
+}
+
+/*
+ * Computes the BWT of count characters from src into dst.
+ *
+ * The end of block sentinel is not stored; instead, its row is stored in
+ * primary and the other count rows are stored in order.
+ */
+void bwtForward(const uint8_t* src, uint32_t count, uint8_t* dst, uint32_t* primary){
+	*primary = 0;
+	if (count == 0){
+		return;
+	}
+
+	// Shift the characters up by one to make room for the sentinel
+	int32_t n = count + 1;
+	std::vector<int32_t> s(n);
+	std::vector<int32_t> SA(n);
+	for (uint32_t i = 0; i < count; i++){
+		s[i] = src[i] + 1;
+	}
+	s[count] = 0;
+
+	sais(&s[0], &SA[0], n, 256);
+
+	uint32_t j = 0;
+	for (int32_t i = 0; i < n; i++){
+		if (SA[i] == 0){
+			*primary = i;
+		} else{
+			dst[j++] = src[SA[i] - 1];
+		}
+	}
+}
+
+/*
+ * Inverts bwtForward().
+ */
+void bwtInverse(const uint8_t* src, uint32_t count, uint32_t primary, uint8_t* dst){
+	if (count == 0){
+		return;
+	}
+
+	// The sentinel sorts before everything, so each character's rows start one later
+	uint32_t start[256] = {0};
+	for (uint32_t i = 0; i < count; i++){
+		start[src[i]]++;
+	}
+	uint32_t sum = 1;
+	for (int c = 0; c < 256; c++){
+		uint32_t tmp = start[c];
+		start[c] = sum;
+		sum += tmp;
+	}
+
+	// The LF mapping: the row of the suffix one character to the left
+	std::vector<uint32_t> lf(count + 1);
+	for (uint32_t i = 0; i <= count; i++){
+		if (i == primary){
+			lf[i] = 0;
+		} else{
+			lf[i] = start[src[i < primary ? i : i - 1]]++;
+		}
+	}
+
+	// Row 0 is the sentinel's suffix, whose last column holds the final character
+	uint32_t row = 0;
+	for (uint32_t k = count; k > 0; k--){
+		dst[k - 1] = src[row < primary ? row : row - 1];
+		row = lf[row];
+	}
+}
+
+/*
+ * Replaces each character with its rank in a list of recently used
+ * characters, then moves it to the front of the list.
+ */
+void mtfEncode(const uint8_t* src, uint32_t count, uint8_t* dst){
+	uint8_t list[256];
+	for (int i = 0; i < 256; i++){
+		list[i] = i;
+	}
+
+	for (uint32_t i = 0; i < count; i++){
+		uint8_t c = src[i];
+		uint8_t rank = 0;
+		uint8_t prev = list[0];
+		while (prev != c){
+			rank++;
+			uint8_t tmp = list[rank];
+			list[rank] = prev;
+			prev = tmp;
+		}
+		list[0] = c;
+		dst[i] = rank;
+	}
+}
+
+/*
+ * Inverts mtfEncode().
+ */
+void mtfDecode(const uint8_t* src, uint32_t count, uint8_t* dst){
+	uint8_t list[256];
+	for (int i = 0; i < 256; i++){
+		list[i] = i;
+	}
+
+	for (uint32_t i = 0; i < count; i++){
+		uint8_t rank = src[i];
+		uint8_t c = list[rank];
+		for (int j = rank; j > 0; j--){
+			list[j] = list[j - 1];
+		}
+		list[0] = c;
+		dst[i] = c;
+	}
+}
+
+/*
+ * Starts the rank Models with a prior that falls off with the square
+ * of the rank, which is roughly the shape of move-to-front output.
+ */
+BwtModels::BwtModels(){
+	for (int ctx = 0; ctx < 2; ctx++){
+		for (int i = 0; i < 256; i++){
+			ranks[ctx].update(i, 1 + 256 / ((i + 1) * (i + 1)));
+		}
+	}
+
+	escape.update(0);
+	escape.update(1);
+
+	for (int i = 0; i < 256; i++){
+		raw.update(i);
+	}
+}
+
+/*
+ * Appends a run of count zero ranks as bijective base 2 digits.
+ */
+static void putRun(std::vector<uint8_t>* symbols, uint32_t count){
+	while (count > 0){
+		if (count & 0x1){
+			symbols->push_back(BWT_RUNA);
+			count = (count - 1) / 2;
+		} else{
+			symbols->push_back(BWT_RUNB);
+			count = (count - 2) / 2;
+		}
+	}
+}
+
+BwtEncoder::BwtEncoder(std::ostream* outstream) : are(&models.raw, outstream){
+	out = outstream;
+	timings.sort = 0;
+	timings.mtf = 0;
+	timings.code = 0;
+}
+
+BwtEncoder::~BwtEncoder(){}
+
+/*
+ * Transforms and codes count characters from src as one block.
+ * Returns false if out is NULL.
+ */
+bool BwtEncoder::put(const uint8_t* src, uint32_t count){
+	if (out == NULL){
+		return false;
+	}
+
+	Clock::time_point begin = Clock::now();
+	uint32_t primary;
+	work.resize(count);
+	bwtForward(src, count, work.empty() ? NULL : &work[0], &primary);
+	timings.sort += secondsSince(begin);
+
+	begin = Clock::now();
+	if (count > 0){
+		mtfEncode(&work[0], count, &work[0]);
+	}
+
+	symbols.clear();
+	uint32_t run = 0;
+	for (uint32_t i = 0; i < count; i++){
+		if (work[i] == 0){
+			run++;
+			continue;
+		}
+
+		putRun(&symbols, run);
+		run = 0;
+
+		if (work[i] < BWT_ESCAPE - 1){
+			symbols.push_back(work[i] + 1);
+		} else{
+			symbols.push_back(BWT_ESCAPE);
+			symbols.push_back(work[i] - (BWT_ESCAPE - 1));
+		}
+	}
+	putRun(&symbols, run);
+	timings.mtf += secondsSince(begin);
+
+	begin = Clock::now();
+	for (int i = 0; i < 4; i++){
+		are.setModel(&models.raw);
+		are.put(primary >> (8 * i));
+	}
+
+	int ctx = 0;
+	for (size_t i = 0; i < symbols.size(); i++){
+		uint8_t c = symbols[i];
+		code(&models.ranks[ctx], c);
+		if (c == BWT_ESCAPE){
+			code(&models.escape, symbols[++i]);
+		}
+		ctx = c <= BWT_RUNB;
+	}
+	timings.code += secondsSince(begin);
+
+	return true;
+}
+
+/*
+ * Finishes the underlying ArEncoder. See ArEncoder::finish().
+ */
+int BwtEncoder::finish(){
+	return are.finish();
+}
+
+/*
+ * The time spent in each stage so far.
+ */
+const BwtTimings& BwtEncoder::getTimings(){
+	return timings;
+}
+
+inline void BwtEncoder::code(Model* m, uint8_t c){
+	are.setModel(m);
+	are.put(c);
+	m->adapt(c, BWT_ADAPT_STEP);
+}
+
+BwtDecoder::BwtDecoder(std::istream* in) : ard(&models.raw, in){
+	timings.sort = 0;
+	timings.mtf = 0;
+	timings.code = 0;
+}
+
+BwtDecoder::~BwtDecoder(){}
+
+/*
+ * Decodes one block of count characters into dst.
+ *
+ * Returns the number of characters decoded, which is less than count
+ * only if the stream is corrupt.
+ */
+uint32_t BwtDecoder::get(uint8_t* dst, uint32_t count){
+	Clock::time_point begin = Clock::now();
+	uint32_t primary = 0;
+	for (int i = 0; i < 4; i++){
+		ard.setModel(&models.raw);
+		primary |= (uint32_t) ard.get() << (8 * i);
+	}
+	if (primary > count){
+		return 0;
+	}
+
+	// Undo the zero run coding while decoding, since the run lengths decide when to stop
+	work.resize(count);
+	uint32_t pos = 0;
+	uint32_t run = 0;
+	uint32_t weight = 1;
+	int ctx = 0;
+	while (pos + run < count){
+		uint8_t c = decode(&models.ranks[ctx]);
+		ctx = c <= BWT_RUNB;
+
+		if (c <= BWT_RUNB){
+			run += weight << c;
+			weight <<= 1;
+			continue;
+		}
+
+		for (; run > 0 && pos < count; run--){
+			work[pos++] = 0;
+		}
+		weight = 1;
+
+		if (pos >= count){
+			return 0;
+		}
+
+		if (c == BWT_ESCAPE){
+			work[pos++] = BWT_ESCAPE - 1 + decode(&models.escape);
+		} else{
+			work[pos++] = c - 1;
+		}
+	}
+	if (pos + run > count){
+		return 0;
+	}
+	for (; run > 0; run--){
+		work[pos++] = 0;
+	}
+	timings.code += secondsSince(begin);
+
+	begin = Clock::now();
+	if (count > 0){
+		mtfDecode(&work[0], count, &work[0]);
+	}
+	timings.mtf += secondsSince(begin);
+
+	begin = Clock::now();
+	bwtInverse(work.empty() ? NULL : &work[0], count, primary, dst);
+	timings.sort += secondsSince(begin);
+
+	return count;
+}
+
+/*
+ * Returns the flags of the underlying ArDecoder.
+ */
+uint8_t BwtDecoder::getFlags(){
+	return ard.getFlags();
+}
+
+/*
+ * The time spent in each stage so far.
+ */
+const BwtTimings& BwtDecoder::getTimings(){
+	return timings;
+}
+
+inline uint8_t BwtDecoder::decode(Model* m){
+	ard.setModel(m);
+	uint8_t c = ard.get();
+	m->adapt(c, BWT_ADAPT_STEP);
+	return c;
+}
@@ -0,0 +1,94 @@
+#ifndef BWT_INCLUDED
+#define BWT_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+#include "Model.h"
+#include "ArEncoder.h"
+#include "ArDecoder.h"
+
+/*
+ * A block sorting pipeline for the arithmetic coder:
+ * Burrows-Wheeler transform, then move-to-front, then zero run coding,
+ * then adaptive Models tuned for the move-to-front ranks.
+ *
+ * Every call to BwtEncoder::put() codes one block. Blocks share nothing
+ * but the stream, so separate blocks can be transformed in parallel.
+ */
+
+const uint32_t BWT_DEFAULT_BLOCK = 900000;
+
+// Zero run coding symbols; ranks r from 1 to 253 are coded as r + 1
+const uint8_t BWT_RUNA		= 0;
+const uint8_t BWT_RUNB		= 1;
+const uint8_t BWT_ESCAPE	= 255;	// Ranks 254 and 255, followed by one raw bit
+
+// Time spent in each stage, in seconds
+struct BwtTimings{
+	double sort;	// Forward or inverse BWT
+	double mtf;		// Move-to-front and zero run coding, or their inverses
+	double code;	// Arithmetic coding
+};
+
+void bwtForward(const uint8_t* src, uint32_t count, uint8_t* dst, uint32_t* primary);
+void bwtInverse(const uint8_t* src, uint32_t count, uint32_t primary, uint8_t* dst);
+
+void mtfEncode(const uint8_t* src, uint32_t count, uint8_t* dst);
+void mtfDecode(const uint8_t* src, uint32_t count, uint8_t* dst);
+
+/*
+ * The Models shared (in mirrored state) by BwtEncoder and BwtDecoder.
+ */
+class BwtModels{
+public:
+	BwtModels();
+
+	Model ranks[2];		// Coded symbols, by whether the previous symbol was part of a zero run
+	Model escape;		// The bit after BWT_ESCAPE
+	Model raw;			// Flat, for the primary index
+};
+
+class BwtEncoder{
+public:
+	BwtEncoder(std::ostream* out);
+	~BwtEncoder();
+
+	bool put(const uint8_t* src, uint32_t count);
+	int finish();
+
+	const BwtTimings& getTimings();
+private:
+	BwtModels models;
+	ArEncoder are;
+	std::ostream* out;
+	BwtTimings timings;
+
+	std::vector<uint8_t> work;
+	std::vector<uint8_t> symbols;
+
+	inline void code(Model* m, uint8_t c);
+};
+
+class BwtDecoder{
+public:
+	BwtDecoder(std::istream* in);
+	~BwtDecoder();
+
+	uint32_t get(uint8_t* dst, uint32_t count);
+	uint8_t getFlags();
+
+	const BwtTimings& getTimings();
+private:
+	BwtModels models;
+	ArDecoder ard;
+	BwtTimings timings;
+
+	std::vector<uint8_t> work;
+
+	inline uint8_t decode(Model* m);
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "CompactModel.h"
+#include "bitTwiddle.h"
+
+#include <string.h>
+
+/*
+ * Creates an empty model. If sorted is false, the characters stay in
+ * their natural order, which saves the reordering on update() but makes
+ * the scans longer.
+ */
+CompactModel::CompactModel(bool sort){
+	sorted = sort;
+	reset();
+}
+
+/*
+ * Adds a character to the model.
+ */
+bool CompactModel::update(uint8_t c){
+	return update(c, 1);
+}
+
+/*
+ * Adds count to c's count, or takes it away if count is negative. If the
+ * total would pass COMPACT_LIMIT, every count is halved first, as often
+ * as it takes.
+ *
+ * Halving never takes a count below 1, so the total cannot fall below
+ * the number of characters present. Returns false, without changing
+ * anything, if count is larger than COMPACT_LIMIT less that number, or
+ * would take c's count below 0.
+ */
+bool CompactModel::update(uint8_t c, int count){
+	if (count > (int) COMPACT_LIMIT){
+		return false;
+	}
+
+	int r = find(c);
+	if (count < 0 && freqs[r] < -count){
+		return false;
+	}
+	if (count == 0){
+		return true;
+	}
+
+	if (total + count > (int) COMPACT_LIMIT){
+		int present = 0;
+		for (int i = 0; i < 256; i++){
+			present += freqs[i] ? 1 : 0;
+		}
+		if (count > (int) COMPACT_LIMIT - present){
+			return false;
+		}
+
+		while (total + count > (int) COMPACT_LIMIT){
+			rescale();
+		}
+	}
+
+	freqs[r] += count;
+	total += count;
+	lastValid = false;
+
+	if (sorted){
+		// Move c up past rarer characters, or down past more common ones
+		while (r > 0 && freqs[r] > freqs[r - 1]){
+			uint16_t f = freqs[r];
+			freqs[r] = freqs[r - 1];
+			freqs[r - 1] = f;
+			chars[r] = chars[r - 1];
+			chars[r - 1] = c;
+			r--;
+		}
+		while (r < 255 && freqs[r] < freqs[r + 1]){
+			uint16_t f = freqs[r];
+			freqs[r] = freqs[r + 1];
+			freqs[r + 1] = f;
+			chars[r] = chars[r + 1];
+			chars[r + 1] = c;
+			r++;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Calculates the upper bound of c, given the restrictions top and bot.
+ * See Model::calcUpper().
+ */
+uint32_t CompactModel::calcUpper(uint8_t c, uint32_t bot, uint32_t top){
+	bounds(c);
+
+	// If this character has no slots, return the shadow "not present" value
+	if (lastLow == lastHigh){
+		return bot + 1;
+	}
+
+	uint64_t range = (uint64_t) top + 1 - bot;
+	uint32_t offset = CEIL_DIV((lastHigh + 1) * range, (uint32_t) total + 1);
+
+	return bot + offset - 1;
+}
+
+/*
+ * Calculates the lower bound of c, given the restrictions top and bot.
+ * See Model::calcLower().
+ */
+uint32_t CompactModel::calcLower(uint8_t c, uint32_t bot, uint32_t top){
+	bounds(c);
+
+	// If this character has no slots, return the shadow "not present" value
+	if (lastLow == lastHigh){
+		return bot;
+	}
+
+	uint64_t range = (uint64_t) top + 1 - bot;
+	uint32_t offset = CEIL_DIV((lastLow + 1) * range, (uint32_t) total + 1);
+
+	return bot + offset;
+}
+
+/*
+ * Calculates the character given an encoding within a certain range, by
+ * adding up the counts from the most common character until they reach
+ * it.
+ */
+uint8_t CompactModel::getChar(uint32_t enc, uint32_t bot, uint32_t top){
+	// Scale enc onto the total number of characters seen
+	uint64_t range = (uint64_t) top + 1 - bot;
+	enc = (uint64_t) (enc - bot) * ((uint32_t) total + 1) / range;
+
+	uint32_t high = 0;
+	int r = 0;
+	for (; r < 255; r++){
+		high += freqs[r];
+		if (high >= enc){
+			break;
+		}
+	}
+	if (r == 255){
+		high += freqs[r];
+	}
+
+	// The coder asks for this character's bounds next
+	lastChar = chars[r];
+	lastLow = high - freqs[r];
+	lastHigh = high;
+	lastValid = true;
+
+	return lastChar;
+}
+
+uint32_t CompactModel::getTotal(){
+	return total;
+}
+
+uint32_t CompactModel::getCharCount(uint8_t c){
+	return freqs[find(c)];
+}
+
+/*
+ * Completely resets the model.
+ */
+void CompactModel::reset(){
+	for (int i = 0; i < 256; i++){
+		freqs[i] = 0;
+		chars[i] = i;
+	}
+	total = 0;
+	lastValid = false;
+}
+
+/*
+ * Halves every count, rounding up so that no character loses its slot.
+ * The order of the characters does not change.
+ */
+void CompactModel::rescale(){
+	total = 0;
+	for (int i = 0; i < 256; i++){
+		freqs[i] = (freqs[i] + 1) / 2;
+		total += freqs[i];
+	}
+	lastValid = false;
+}
+
+/*
+ * The rank of c, which is found soonest for common characters.
+ */
+inline int CompactModel::find(uint8_t c){
+	if (!sorted){
+		return c;
+	}
+
+	return (const uint8_t*) memchr(chars, c, sizeof(chars)) - chars;
+}
+
+/*
+ * Sets lastLow and lastHigh to the running totals before and after c.
+ */
+inline void CompactModel::bounds(uint8_t c){
+	if (lastValid && lastChar == c){
+		return;
+	}
+
+	int r = find(c);
+	uint32_t low = 0;
+	for (int i = 0; i < r; i++){
+		low += freqs[i];
+	}
+
+	lastChar = c;
+	lastLow = low;
+	lastHigh = low + freqs[r];
+	lastValid = true;
+}
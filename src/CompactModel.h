@@ -0,0 +1,59 @@
+#ifndef COMPACTMODEL_INCLUDED
+#define COMPACTMODEL_INCLUDED
+
+#include <stdint.h>
+
+const uint32_t COMPACT_LIMIT = 0xFFFF;	// Counts are halved before the total passes this
+
+/*
+ * A smaller Model for when many are live at once, such as one per
+ * context, column, or connection. It is coded with
+ * ArEncoder::put(CompactModel*, ...) and ArDecoder::get(CompactModel*).
+ *
+ * The counts are 16 bit and kept apart rather than as running totals,
+ * and the model halves them itself whenever the total would pass
+ * COMPACT_LIMIT, so it never needs digesting or rescaling by hand.
+ *
+ * If sorted, the characters are also kept in order of frequency, so the
+ * common ones share the first cache line and the scans for their bounds
+ * stop after a few steps. Each update moves its character up past any
+ * that have become rarer.
+ *
+ * It has the same shadow "not present" slot as Model, but its streams
+ * are not interchangeable with Model's.
+ */
+class CompactModel{
+public:
+	CompactModel(bool sorted = true);
+
+	bool update(uint8_t c);
+	bool update(uint8_t c, int count);
+
+	uint32_t calcUpper(uint8_t c, uint32_t bot, uint32_t top);
+	uint32_t calcLower(uint8_t c, uint32_t bot, uint32_t top);
+
+	uint8_t getChar(uint32_t enc, uint32_t bot, uint32_t top);
+	uint32_t getTotal();
+	uint32_t getCharCount(uint8_t c);
+
+	void reset();
+	void rescale();
+
+private:
+	uint16_t freqs[256];	// By rank
+	uint8_t chars[256];		// The character at each rank
+	uint16_t total;
+	bool sorted;
+
+	// The bounds of the last character looked up, which the coders ask
+	// for two or three times in a row
+	uint8_t lastChar;
+	bool lastValid;
+	uint16_t lastLow;
+	uint16_t lastHigh;
+
+	inline int find(uint8_t c);
+	inline void bounds(uint8_t c);
+};
+
+#endif
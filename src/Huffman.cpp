@@ -0,0 +1,380 @@
+#include "Huffman.h"
+#include "Model.h"
+
+#include <algorithm>
+#include <queue>
+#include <vector>
+#include <string.h>
+
+const uint32_t TABLE_MASK = (0x1 << HUFF_MAX_BITS) - 1;
+
+// Table entries
+#define ENTRY(first, second, bits, count)	((first) | (second) << 8 | (bits) << 16 | (uint32_t) (count) << 24)
+#define ENTRY_BITS(e)	(((e) >> 16) & 0xFF)
+#define ENTRY_COUNT(e)	((e) >> 24)
+
+HuffmanCoder::HuffmanCoder(){
+	ready = false;
+	memset(lengths, 0, sizeof(lengths));
+	memset(codes, 0, sizeof(codes));
+	memset(table, 0, sizeof(table));
+}
+
+HuffmanCoder::~HuffmanCoder(){}
+
+/*
+ * Builds the code from the counts in m. Characters with no count get no
+ * code and cannot be encoded.
+ * Returns false if m is NULL or empty.
+ */
+bool HuffmanCoder::build(Model* m){
+	if (m == NULL){
+		return false;
+	}
+
+	uint32_t counts[256];
+	for (int i = 0; i < 256; i++){
+		counts[i] = m->getCharCount(i);
+	}
+	return build(counts);
+}
+
+/*
+ * Builds the code from 256 counts.
+ * Returns false if they are all 0.
+ */
+bool HuffmanCoder::build(const uint32_t* counts){
+	ready = false;
+
+	bool any = false;
+	for (int i = 0; i < 256; i++){
+		any |= counts[i] > 0;
+	}
+	if (!any){
+		return false;
+	}
+
+	limitLengths(counts, lengths);
+	return assign();
+}
+
+/*
+ * Rebuilds a code from HUFF_LENGTHS_SIZE bytes written by getLengths().
+ * Returns false if the lengths do not form a valid code.
+ */
+bool HuffmanCoder::setLengths(const uint8_t* packed){
+	ready = false;
+
+	for (int i = 0; i < 256; i += 2){
+		lengths[i] = packed[i / 2] & 0xF;
+		lengths[i + 1] = packed[i / 2] >> 4;
+	}
+	return assign();
+}
+
+/*
+ * Writes the code lengths into HUFF_LENGTHS_SIZE bytes, two to a byte.
+ */
+void HuffmanCoder::getLengths(uint8_t* packed){
+	for (int i = 0; i < 256; i += 2){
+		packed[i / 2] = lengths[i] | lengths[i + 1] << 4;
+	}
+}
+
+bool HuffmanCoder::good(){
+	return ready;
+}
+
+/*
+ * The length of c's code in bits, or 0 if it has none.
+ */
+uint8_t HuffmanCoder::getLength(uint8_t c){
+	return lengths[c];
+}
+
+/*
+ * The number of bits it would take to encode characters with the given
+ * 256 counts, for comparing against other engines. Characters with no
+ * code make this UINT64_MAX.
+ */
+uint64_t HuffmanCoder::getCost(const uint32_t* counts){
+	uint64_t bits = 0;
+	for (int i = 0; i < 256; i++){
+		if (counts[i] && !lengths[i]){
+			return UINT64_MAX;
+		}
+		bits += (uint64_t) counts[i] * lengths[i];
+	}
+	return bits;
+}
+
+/*
+ * The most bytes that encoding count characters can produce, with the
+ * room that the 64 bit stores need.
+ */
+size_t HuffmanCoder::bound(size_t count){
+	return count / 8 * HUFF_MAX_BITS + HUFF_MAX_BITS + 8;
+}
+
+/*
+ * Encodes count characters from src into dst, which must have room for
+ * bound(count) bytes.
+ *
+ * Returns the number of bytes written, or 0 if there is no code, cap is
+ * too small, or a character has no code.
+ */
+size_t HuffmanCoder::encode(const uint8_t* src, size_t count, uint8_t* dst, size_t cap){
+	if (!ready || cap < bound(count)){
+		return 0;
+	}
+
+	uint8_t* p = dst;
+	uint64_t buf = 0;
+	int n = 0;
+
+	// Four codes fit above the at most 7 bits left over between stores
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4){
+		for (int k = 0; k < 4; k++){
+			uint8_t c = src[i + k];
+			if (!lengths[c]){
+				return 0;
+			}
+			buf |= (uint64_t) codes[c] << n;
+			n += lengths[c];
+		}
+
+		memcpy(p, &buf, sizeof(buf));
+		p += n >> 3;
+		buf >>= n & ~7;
+		n &= 7;
+	}
+	for (; i < count; i++){
+		uint8_t c = src[i];
+		if (!lengths[c]){
+			return 0;
+		}
+		buf |= (uint64_t) codes[c] << n;
+		n += lengths[c];
+	}
+
+	memcpy(p, &buf, sizeof(buf));
+	p += (n + 7) >> 3;
+
+	return p - dst;
+}
+
+/*
+ * Decodes exactly count characters from the len bytes at src into dst.
+ *
+ * Returns the number of characters decoded, which is less than count only
+ * if src ends early.
+ */
+size_t HuffmanCoder::decode(const uint8_t* src, size_t len, uint8_t* dst, size_t count){
+	if (!ready){
+		return 0;
+	}
+
+	size_t out = 0;
+	uint64_t pos = 0;	// In bits
+
+	// Every load gives at least 57 bits, enough for five lookups, each of
+	// which writes two characters
+	while (out + 10 <= count && (pos >> 3) + 8 <= len){
+		uint64_t w;
+		memcpy(&w, src + (pos >> 3), sizeof(w));
+		w >>= pos & 7;
+
+		for (int k = 0; k < 5; k++){
+			uint32_t e = table[w & TABLE_MASK];
+			dst[out] = e;
+			dst[out + 1] = e >> 8;
+			out += ENTRY_COUNT(e);
+			w >>= ENTRY_BITS(e);
+			pos += ENTRY_BITS(e);
+		}
+	}
+
+	// Near the ends, load byte by byte and pad with zeros
+	uint64_t end = (uint64_t) len * 8;
+	while (out < count && pos < end){
+		uint64_t w = 0;
+		size_t at = pos >> 3;
+		memcpy(&w, src + at, len - at < sizeof(w) ? len - at : sizeof(w));
+		w >>= pos & 7;
+
+		uint32_t e = table[w & TABLE_MASK];
+		dst[out++] = e;
+		if (ENTRY_COUNT(e) == 1){
+			pos += ENTRY_BITS(e);
+		} else if (out < count){
+			dst[out++] = e >> 8;
+			pos += ENTRY_BITS(e);
+		} else {
+			pos += lengths[e & 0xFF];
+		}
+	}
+
+	// The last code may have run past the end
+	if (pos > end){
+		out--;
+	}
+
+	return out;
+}
+
+/*
+ * Turns the code lengths into canonical codes and fills the decoding
+ * table.
+ * Returns false if the lengths do not form a valid code.
+ */
+bool HuffmanCoder::assign(){
+	// Check the Kraft sum, in units of 2 ^ -HUFF_MAX_BITS
+	uint32_t kraft = 0;
+	int perLength[HUFF_MAX_BITS + 1] = {0};
+	for (int i = 0; i < 256; i++){
+		if (lengths[i] > HUFF_MAX_BITS){
+			return false;
+		}
+		if (lengths[i]){
+			kraft += 0x1 << (HUFF_MAX_BITS - lengths[i]);
+			perLength[lengths[i]]++;
+		}
+	}
+	if (kraft == 0 || kraft > (0x1 << HUFF_MAX_BITS)){
+		return false;
+	}
+
+	// Canonical codes: shorter first, then by character
+	uint32_t next[HUFF_MAX_BITS + 1] = {0};
+	uint32_t code = 0;
+	for (int len = 1; len <= HUFF_MAX_BITS; len++){
+		code = (code + perLength[len - 1]) << 1;
+		next[len] = code;
+	}
+
+	// Unused indices, only possible with an incomplete code, give a NULL
+	// and skip all of their bits so that corrupt input cannot stall
+	for (uint32_t i = 0; i <= TABLE_MASK; i++){
+		table[i] = ENTRY(0, 0, HUFF_MAX_BITS, 1);
+	}
+
+	for (int c = 0; c < 256; c++){
+		int len = lengths[c];
+		if (!len){
+			codes[c] = 0;
+			continue;
+		}
+
+		uint32_t reversed = 0;
+		uint32_t canonical = next[len]++;
+		for (int b = 0; b < len; b++){
+			reversed |= ((canonical >> b) & 0x1) << (len - 1 - b);
+		}
+		codes[c] = reversed;
+
+		for (uint32_t i = reversed; i <= TABLE_MASK; i += 0x1 << len){
+			table[i] = ENTRY(c, 0, len, 1);
+		}
+	}
+
+	// Add a second character wherever its code fits in the rest of the
+	// index. Unused indices take all of the bits, so they are left alone.
+	std::vector<uint32_t> single(table, table + TABLE_MASK + 1);
+	for (uint32_t i = 0; i <= TABLE_MASK; i++){
+		int len = ENTRY_BITS(single[i]);
+		uint32_t after = single[i >> len];
+		if (len + ENTRY_BITS(after) <= HUFF_MAX_BITS){
+			table[i] = ENTRY(single[i] & 0xFF, after & 0xFF, len + ENTRY_BITS(after), 2);
+		}
+	}
+
+	ready = true;
+	return true;
+}
+
+/*
+ * Computes Huffman code lengths for the counts, then limits them to
+ * HUFF_MAX_BITS. Codes that are too long are cut short, and the codes
+ * nearest the limit are lengthened until the Kraft sum fits again. Any
+ * room left over then goes to shortening the most common codes.
+ */
+void HuffmanCoder::limitLengths(const uint32_t* counts, uint8_t* lengths){
+	typedef std::pair<uint64_t, int> Node;
+	std::priority_queue<Node, std::vector<Node>, std::greater<Node> > queue;
+
+	// Leaves are 0 to 255, and joined nodes follow
+	int parent[511];
+	int nodes = 256;
+	int present = 0;
+	for (int i = 0; i < 256; i++){
+		lengths[i] = 0;
+		if (counts[i]){
+			queue.push(Node(counts[i], i));
+			present++;
+		}
+	}
+
+	if (present == 1){
+		lengths[queue.top().second] = 1;
+		return;
+	}
+
+	while (queue.size() > 1){
+		Node a = queue.top();
+		queue.pop();
+		Node b = queue.top();
+		queue.pop();
+
+		parent[a.second] = nodes;
+		parent[b.second] = nodes;
+		queue.push(Node(a.first + b.first, nodes));
+		nodes++;
+	}
+
+	// Parents always come after their children, so walk down from the root
+	int depth[511];
+	depth[nodes - 1] = 0;
+	for (int i = nodes - 2; i >= 256; i--){
+		depth[i] = depth[parent[i]] + 1;
+	}
+
+	uint32_t kraft = 0;
+	for (int i = 0; i < 256; i++){
+		if (counts[i]){
+			int d = depth[parent[i]] + 1;
+			lengths[i] = d > HUFF_MAX_BITS ? HUFF_MAX_BITS : d;
+			kraft += 0x1 << (HUFF_MAX_BITS - lengths[i]);
+		}
+	}
+
+	const uint32_t full = 0x1 << HUFF_MAX_BITS;
+	while (kraft > full){
+		// The rarest of the longest codes below the limit
+		int pick = -1;
+		for (int i = 0; i < 256; i++){
+			if (lengths[i] && lengths[i] < HUFF_MAX_BITS && (pick < 0 || lengths[i] > lengths[pick]
+					|| (lengths[i] == lengths[pick] && counts[i] < counts[pick]))){
+				pick = i;
+			}
+		}
+		lengths[pick]++;
+		kraft -= 0x1 << (HUFF_MAX_BITS - lengths[pick]);
+	}
+
+	// Most common first
+	std::vector<Node> order;
+	for (int i = 0; i < 256; i++){
+		if (counts[i]){
+			order.push_back(Node(~(uint64_t) counts[i], i));
+		}
+	}
+	std::sort(order.begin(), order.end());
+	for (size_t k = 0; k < order.size(); k++){
+		int i = order[k].second;
+		while (lengths[i] > 1 && kraft + (0x1 << (HUFF_MAX_BITS - lengths[i])) <= full){
+			kraft += 0x1 << (HUFF_MAX_BITS - lengths[i]);
+			lengths[i]--;
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef HUFFMAN_INCLUDED
+#define HUFFMAN_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Model;
+
+const int HUFF_MAX_BITS = 11;				// The longest code, and the decode table's index size
+const int HUFF_LENGTHS_SIZE = 128;		// Bytes taken by the code lengths, two per byte
+
+/*
+ * A canonical Huffman coder, for paths where decoding speed matters
+ * more than the last few percent of ratio.
+ *
+ * Codes are built from a Model's counts and limited to HUFF_MAX_BITS
+ * bits, so that any code can be read with one lookup in a table of
+ * 2 ^ HUFF_MAX_BITS entries. Each entry holds up to two characters,
+ * when the second one's code also fits in the index, so common
+ * characters come out two at a time.
+ *
+ * Bits are written least significant first through a 64 bit buffer.
+ * Since the code is canonical, the lengths alone (HUFF_LENGTHS_SIZE
+ * bytes) are enough to rebuild it, which is what ENGINE_HUFFMAN frames
+ * store.
+ */
+class HuffmanCoder{
+public:
+	HuffmanCoder();
+	~HuffmanCoder();
+
+	bool build(Model* m);
+	bool build(const uint32_t* counts);
+	bool setLengths(const uint8_t* lengths);
+	void getLengths(uint8_t* lengths);
+
+	bool good();
+	uint8_t getLength(uint8_t c);
+	uint64_t getCost(const uint32_t* counts);
+
+	static size_t bound(size_t count);
+	size_t encode(const uint8_t* src, size_t count, uint8_t* dst, size_t cap);
+	size_t decode(const uint8_t* src, size_t len, uint8_t* dst, size_t count);
+private:
+	bool ready;
+	uint8_t lengths[256];
+	uint32_t codes[256];	// Bit reversed, so that they can be written least significant first
+
+	// Per HUFF_MAX_BITS bits of input: the first character, the second
+	// character, the bits used, and the number of characters, a byte each
+	uint32_t table[1 << HUFF_MAX_BITS];
+
+	bool assign();
+	static void limitLengths(const uint32_t* counts, uint8_t* lengths);
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "Int.h"
+
+IntModels::IntModels(int t){
+	for (int bits = 1; bits <= 8; bits++){
+		for (int i = 0; i < (0x1 << bits); i++){
+			raw[bits].update(i);
+		}
+	}
+
+	transform = (t == INT_DELTA || t == INT_DELTA2) ? t : INT_RAW;
+	last = 0;
+	lastDelta = 0;
+	lastExp = 0;
+	lastSign = 0;
+}
+
+/*
+ * Turns a value into its residual and records it. The arithmetic is
+ * done unsigned, so differences wrap instead of overflowing.
+ */
+uint64_t IntModels::forward(int64_t v){
+	uint64_t x = v;
+	uint64_t r = x;
+
+	if (transform != INT_RAW){
+		uint64_t delta = x - last;
+		r = transform == INT_DELTA ? delta : delta - lastDelta;
+		lastDelta = delta;
+	}
+	last = x;
+
+	return r;
+}
+
+/*
+ * Turns a residual back into its value and records it.
+ */
+int64_t IntModels::inverse(uint64_t r){
+	uint64_t x = r;
+
+	if (transform != INT_RAW){
+		uint64_t delta = transform == INT_DELTA ? r : r + lastDelta;
+		x = last + delta;
+		lastDelta = delta;
+	}
+	last = x;
+
+	return (int64_t) x;
+}
+
+IntEncoder::IntEncoder(std::ostream* outstream, int transform) : models(transform), are(&models.raw[8], outstream){
+	out = outstream;
+}
+
+IntEncoder::~IntEncoder(){}
+
+/*
+ * Codes a value.
+ * Returns false if out is NULL.
+ */
+bool IntEncoder::put(int64_t v){
+	if (out == NULL){
+		return false;
+	}
+
+	code(models.forward(v));
+
+	return true;
+}
+
+/*
+ * Codes count values from src.
+ * Returns false if out is NULL.
+ */
+bool IntEncoder::put(const int64_t* src, size_t count){
+	if (out == NULL){
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++){
+		code(models.forward(src[i]));
+	}
+
+	return true;
+}
+
+/*
+ * Finishes the underlying ArEncoder. See ArEncoder::finish().
+ */
+int IntEncoder::finish(){
+	return are.finish();
+}
+
+/*
+ * Codes a residual as its exponent, sign, and mantissa.
+ */
+inline void IntEncoder::code(uint64_t r){
+	bool negative = (int64_t) r < 0;
+	uint64_t mag = negative ? 0 - r : r;
+	int e = mag ? 64 - __builtin_clzll(mag) : 0;
+
+	BitModel* tree = models.exponents[models.lastExp];
+	int node = 1;
+	for (int i = 6; i >= 0; i--){
+		int bit = (e >> i) & 0x1;
+		codeBit(&tree[node], bit);
+		node = (node << 1) | bit;
+	}
+
+	if (e > 0){
+		codeBit(&models.signs[models.lastSign], negative);
+	}
+
+	// The bits below the leading 1, most significant first
+	int rest = e - 1;
+	int modeled = rest < INT_MODELED_BITS ? rest : INT_MODELED_BITS;
+	node = 1;
+	while (modeled-- > 0){
+		int bit = (mag >> --rest) & 0x1;
+		codeBit(&models.mantissas[e][node], bit);
+		node = (node << 1) | bit;
+	}
+	if (rest > 0){
+		codeRaw(mag, rest);
+	}
+
+	models.lastExp = e;
+	models.lastSign = e ? (negative ? 2 : 1) : 0;
+}
+
+inline void IntEncoder::codeBit(BitModel* bm, int bit){
+	are.put(bm, bit);
+	bm->update(bit);
+}
+
+/*
+ * Codes the rightmost count bits of bits with the flat Models, up to 8
+ * at a time, most significant first.
+ */
+inline void IntEncoder::codeRaw(uint64_t bits, int count){
+	while (count > 0){
+		int chunk = count % 8 ? count % 8 : 8;
+		count -= chunk;
+		are.setModel(&models.raw[chunk]);
+		are.put((bits >> count) & ((0x1 << chunk) - 1));
+	}
+}
+
+IntDecoder::IntDecoder(std::istream* in, int transform) : models(transform), ard(&models.raw[8], in){}
+
+IntDecoder::~IntDecoder(){}
+
+/*
+ * Decodes a value. Like ArDecoder, it does not know when to stop.
+ */
+int64_t IntDecoder::get(){
+	return models.inverse(decode());
+}
+
+/*
+ * Decodes exactly count values into dst.
+ * Returns the number of values decoded.
+ */
+size_t IntDecoder::get(int64_t* dst, size_t count){
+	for (size_t i = 0; i < count; i++){
+		dst[i] = models.inverse(decode());
+	}
+
+	return count;
+}
+
+/*
+ * See ArDecoder::getFlags().
+ */
+uint8_t IntDecoder::getFlags(){
+	return ard.getFlags();
+}
+
+inline uint64_t IntDecoder::decode(){
+	BitModel* tree = models.exponents[models.lastExp];
+	int node = 1;
+	for (int i = 0; i < 7; i++){
+		node = (node << 1) | decodeBit(&tree[node]);
+	}
+	int e = node - 128;
+
+	// A corrupt stream can give exponents past 64
+	if (e >= INT_EXPONENTS){
+		e = INT_EXPONENTS - 1;
+	}
+
+	bool negative = false;
+	if (e > 0){
+		negative = decodeBit(&models.signs[models.lastSign]);
+	}
+
+	uint64_t mag = e ? 1 : 0;
+	int rest = e - 1;
+	int modeled = rest < INT_MODELED_BITS ? rest : INT_MODELED_BITS;
+	node = 1;
+	while (modeled-- > 0){
+		int bit = decodeBit(&models.mantissas[e][node]);
+		node = (node << 1) | bit;
+		mag = (mag << 1) | bit;
+		rest--;
+	}
+	if (rest > 0){
+		mag = (mag << rest) | decodeRaw(rest);
+	}
+
+	models.lastExp = e;
+	models.lastSign = e ? (negative ? 2 : 1) : 0;
+
+	return negative ? 0 - mag : mag;
+}
+
+inline int IntDecoder::decodeBit(BitModel* bm){
+	int bit = ard.get(bm);
+	bm->update(bit);
+	return bit;
+}
+
+inline uint64_t IntDecoder::decodeRaw(int count){
+	uint64_t bits = 0;
+	while (count > 0){
+		int chunk = count % 8 ? count % 8 : 8;
+		count -= chunk;
+		ard.setModel(&models.raw[chunk]);
+		bits = (bits << chunk) | ard.get();
+	}
+	return bits;
+}
@@ -0,0 +1,93 @@
+#ifndef INT_INCLUDED
+#define INT_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Model.h"
+#include "BitModel.h"
+#include "ArEncoder.h"
+#include "ArDecoder.h"
+
+/*
+ * An integer front end for the arithmetic coder, for time series such as
+ * counters, timestamps, and sensor readings.
+ *
+ * Each value is first turned into a residual by one of the transforms
+ * below. The residual is then binarized into its exponent (the number of
+ * bits in its magnitude), its sign, and the bits below its leading 1.
+ * The exponent is coded with a tree of BitModels chosen by the previous
+ * exponent, so runs of similar magnitudes cost well under a bit each.
+ * The highest mantissa bits get BitModels of their own for each
+ * exponent, and the rest, which are close to random, are coded flat.
+ */
+
+// Transforms
+const int INT_RAW		= 0;	// The value itself
+const int INT_DELTA		= 1;	// The difference from the previous value
+const int INT_DELTA2	= 2;	// The difference from the previous difference
+
+const int INT_EXPONENTS = 65;		// Magnitudes of 0 to 64 bits
+const int INT_MODELED_BITS = 4;		// Mantissa bits with their own BitModels
+
+/*
+ * The Models and transform state shared (in mirrored state) by
+ * IntEncoder and IntDecoder.
+ */
+class IntModels{
+public:
+	IntModels(int transform);
+
+	BitModel exponents[INT_EXPONENTS][128];		// Bit tree, by the previous exponent
+	BitModel signs[3];							// By the sign of the previous residual
+	BitModel mantissas[INT_EXPONENTS][0x1 << INT_MODELED_BITS];	// Bit tree, by exponent
+	Model raw[9];								// Flat Models for the other mantissa bits
+
+	int transform;
+	uint64_t last;		// The previous value
+	uint64_t lastDelta;	// The previous difference
+	int lastExp;
+	int lastSign;		// 0 for zero, 1 for positive, 2 for negative
+
+	uint64_t forward(int64_t v);
+	int64_t inverse(uint64_t r);
+};
+
+class IntEncoder{
+public:
+	IntEncoder(std::ostream* out, int transform);
+	~IntEncoder();
+
+	bool put(int64_t v);
+	bool put(const int64_t* src, size_t count);
+	int finish();
+private:
+	IntModels models;
+	ArEncoder are;
+	std::ostream* out;
+
+	inline void code(uint64_t r);
+	inline void codeBit(BitModel* bm, int bit);
+	inline void codeRaw(uint64_t bits, int count);
+};
+
+class IntDecoder{
+public:
+	IntDecoder(std::istream* in, int transform);
+	~IntDecoder();
+
+	int64_t get();
+	size_t get(int64_t* dst, size_t count);
+	uint8_t getFlags();
+private:
+	IntModels models;
+	ArDecoder ard;
+
+	inline uint64_t decode();
+	inline int decodeBit(BitModel* bm);
+	inline uint64_t decodeRaw(int count);
+};
+
+#endif
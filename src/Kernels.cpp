@@ -0,0 +1,383 @@
+#include "Kernels.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+/*
+ * Scalar kernels. These are the reference for all of the others.
+ */
+
+static void histogramScalar(const uint8_t* src, size_t count, uint32_t* counts){
+	// Four tables, so that runs of the same byte do not wait on each other
+	uint32_t part[4][256];
+	memset(part, 0, sizeof(part));
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4){
+		part[0][src[i]]++;
+		part[1][src[i + 1]]++;
+		part[2][src[i + 2]]++;
+		part[3][src[i + 3]]++;
+	}
+	for (; i < count; i++){
+		part[0][src[i]]++;
+	}
+
+	for (int c = 0; c < 256; c++){
+		counts[c] += part[0][c] + part[1][c] + part[2][c] + part[3][c];
+	}
+}
+
+static void accumulateScalar(uint32_t* freqs){
+	for (int i = 1; i < 256; i++){
+		freqs[i] += freqs[i - 1];
+	}
+}
+
+static void decumulateScalar(uint32_t* freqs){
+	for (int i = 255; i > 0; i--){
+		freqs[i] -= freqs[i - 1];
+	}
+}
+
+static int searchScalar(const uint32_t* freqs, uint32_t value){
+	// Binary search for the first total that is not below value
+	int upper = 0xFF;	// Inclusive
+	int lower = -1; 	// Exclusive
+	int mid;
+
+	while (upper > lower + 1){
+		mid = (upper + lower) / 2;
+		if (freqs[mid] >= value){
+			upper = mid;
+		} else {
+			lower = mid;
+		}
+	}
+
+	return upper;
+}
+
+static bool gatherScalar(const uint32_t* freqs, const uint8_t* src, size_t count, uint32_t* lows, uint32_t* highs){
+	uint32_t missing = 0;
+	for (size_t i = 0; i < count; i++){
+		uint8_t c = src[i];
+		lows[i] = c ? freqs[c - 1] : 0;
+		highs[i] = freqs[c];
+		missing |= lows[i] == highs[i];
+	}
+	return !missing;
+}
+
+/*
+ * SSE4.2 kernels, four counts to a register.
+ *
+ * A running total within a register takes two shifted adds. The total so
+ * far is carried into the next register by broadcasting its last lane.
+ */
+
+__attribute__((target("sse4.2")))
+static void accumulateSse42(uint32_t* freqs){
+	__m128i carry = _mm_setzero_si128();
+	for (int i = 0; i < 256; i += 4){
+		__m128i x = _mm_loadu_si128((const __m128i*) (freqs + i));
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+		x = _mm_add_epi32(x, carry);
+		_mm_storeu_si128((__m128i*) (freqs + i), x);
+		carry = _mm_shuffle_epi32(x, 0xFF);
+	}
+}
+
+// Going from the top down, each register still sees the untouched total
+// just below it
+__attribute__((target("sse4.2")))
+static void decumulateSse42(uint32_t* freqs){
+	for (int i = 252; i > 0; i -= 4){
+		__m128i x = _mm_loadu_si128((const __m128i*) (freqs + i));
+		__m128i below = _mm_loadu_si128((const __m128i*) (freqs + i - 1));
+		_mm_storeu_si128((__m128i*) (freqs + i), _mm_sub_epi32(x, below));
+	}
+	__m128i x = _mm_loadu_si128((const __m128i*) freqs);
+	_mm_storeu_si128((__m128i*) freqs, _mm_sub_epi32(x, _mm_slli_si128(x, 4)));
+}
+
+// The number of totals in four registers that are below value. Totals
+// can reach 2 ^ 31, so the compare has to be unsigned: x < value exactly
+// when max(x, value) is not x.
+__attribute__((target("sse4.2")))
+static inline int countBelowSse42(__m128i a, __m128i b, __m128i c, __m128i d, __m128i value){
+	__m128i ones = _mm_set1_epi32(-1);
+	a = _mm_xor_si128(_mm_cmpeq_epi32(_mm_max_epu32(a, value), a), ones);
+	b = _mm_xor_si128(_mm_cmpeq_epi32(_mm_max_epu32(b, value), b), ones);
+	c = _mm_xor_si128(_mm_cmpeq_epi32(_mm_max_epu32(c, value), c), ones);
+	d = _mm_xor_si128(_mm_cmpeq_epi32(_mm_max_epu32(d, value), d), ones);
+	__m128i packed = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+	return __builtin_popcount(_mm_movemask_epi8(packed));
+}
+
+// The totals are sorted, so the last total of each block of 16 tells how
+// many whole blocks are below value, and one more compare of 16 totals
+// finishes the count
+__attribute__((target("sse4.2")))
+static int searchSse42(const uint32_t* freqs, uint32_t value){
+	__m128i v = _mm_set1_epi32(value);
+	const uint32_t* f = freqs + 15;
+	int block = countBelowSse42(
+		_mm_setr_epi32(f[0], f[16], f[32], f[48]),
+		_mm_setr_epi32(f[64], f[80], f[96], f[112]),
+		_mm_setr_epi32(f[128], f[144], f[160], f[176]),
+		_mm_setr_epi32(f[192], f[208], f[224], f[240]), v);
+	if (block == 16){
+		return 0xFF;
+	}
+
+	const __m128i* p = (const __m128i*) (freqs + 16 * block);
+	return 16 * block + countBelowSse42(_mm_loadu_si128(p), _mm_loadu_si128(p + 1),
+		_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3), v);
+}
+
+/*
+ * AVX2 kernels, eight counts to a register. The running totals are built
+ * within each 128 bit half first, then the low half's total is added to
+ * the high half.
+ */
+
+__attribute__((target("avx2")))
+static void accumulateAvx2(uint32_t* freqs){
+	__m256i carry = _mm256_setzero_si256();
+	__m256i last = _mm256_set1_epi32(7);
+	for (int i = 0; i < 256; i += 8){
+		__m256i x = _mm256_loadu_si256((const __m256i*) (freqs + i));
+		x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+		x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+		__m256i low = _mm256_shuffle_epi32(x, 0xFF);
+		x = _mm256_add_epi32(x, _mm256_permute2x128_si256(low, low, 0x08));
+		x = _mm256_add_epi32(x, carry);
+		_mm256_storeu_si256((__m256i*) (freqs + i), x);
+		carry = _mm256_permutevar8x32_epi32(x, last);
+	}
+}
+
+__attribute__((target("avx2")))
+static void decumulateAvx2(uint32_t* freqs){
+	for (int i = 248; i > 0; i -= 8){
+		__m256i x = _mm256_loadu_si256((const __m256i*) (freqs + i));
+		__m256i below = _mm256_loadu_si256((const __m256i*) (freqs + i - 1));
+		_mm256_storeu_si256((__m256i*) (freqs + i), _mm256_sub_epi32(x, below));
+	}
+	__m256i x = _mm256_loadu_si256((const __m256i*) freqs);
+	__m256i below = _mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6));
+	below = _mm256_blend_epi32(below, _mm256_setzero_si256(), 0x01);
+	_mm256_storeu_si256((__m256i*) freqs, _mm256_sub_epi32(x, below));
+}
+
+__attribute__((target("avx2")))
+static inline int countBelowAvx2(__m256i a, __m256i b, __m256i value){
+	a = _mm256_cmpeq_epi32(_mm256_max_epu32(a, value), a);
+	b = _mm256_cmpeq_epi32(_mm256_max_epu32(b, value), b);
+	int notBelow = _mm256_movemask_ps(_mm256_castsi256_ps(a)) | _mm256_movemask_ps(_mm256_castsi256_ps(b)) << 8;
+	return 16 - __builtin_popcount(notBelow);
+}
+
+__attribute__((target("avx2")))
+static int searchAvx2(const uint32_t* freqs, uint32_t value){
+	__m256i v = _mm256_set1_epi32(value);
+	__m256i stride = _mm256_setr_epi32(15, 31, 47, 63, 79, 95, 111, 127);
+	int block = countBelowAvx2(_mm256_i32gather_epi32((const int*) freqs, stride, 4),
+		_mm256_i32gather_epi32((const int*) (freqs + 128), stride, 4), v);
+	if (block == 16){
+		return 0xFF;
+	}
+
+	const __m256i* p = (const __m256i*) (freqs + 16 * block);
+	return 16 * block + countBelowAvx2(_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1), v);
+}
+
+// Eight characters at a time. Character 0 is masked out of the gather
+// of the totals below, and keeps the 0 it starts with.
+__attribute__((target("avx2")))
+static bool gatherAvx2(const uint32_t* freqs, const uint8_t* src, size_t count, uint32_t* lows, uint32_t* highs){
+	__m256i missing = _mm256_setzero_si256();
+	__m256i zero = _mm256_setzero_si256();
+	__m256i one = _mm256_set1_epi32(1);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8){
+		__m256i c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (src + i)));
+		__m256i nonzero = _mm256_xor_si256(_mm256_cmpeq_epi32(c, zero), _mm256_set1_epi32(-1));
+		__m256i high = _mm256_i32gather_epi32((const int*) freqs, c, 4);
+		__m256i low = _mm256_mask_i32gather_epi32(zero, (const int*) freqs, _mm256_sub_epi32(c, one), nonzero, 4);
+		_mm256_storeu_si256((__m256i*) (lows + i), low);
+		_mm256_storeu_si256((__m256i*) (highs + i), high);
+		missing = _mm256_or_si256(missing, _mm256_cmpeq_epi32(low, high));
+	}
+
+	bool ok = _mm256_testz_si256(missing, missing);
+	return gatherScalar(freqs, src + i, count - i, lows + i, highs + i) && ok;
+}
+
+/*
+ * AVX-512 kernels, sixteen counts to a register. Shifting lanes across
+ * the whole register is a single alignr, and compares go straight to
+ * mask registers.
+ */
+
+#define AVX512_TARGET __attribute__((target("avx512f,avx512cd,avx512bw,avx512dq,avx512vl")))
+
+// The masked forms, with every lane set, avoid undefined inputs
+static const __mmask16 ALL16 = 0xFFFF;
+
+AVX512_TARGET
+static void accumulateAvx512(uint32_t* freqs){
+	__m512i zero = _mm512_setzero_si512();
+	__m512i carry = zero;
+	__m512i last = _mm512_set1_epi32(15);
+	for (int i = 0; i < 256; i += 16){
+		__m512i x = _mm512_loadu_si512(freqs + i);
+		x = _mm512_add_epi32(x, _mm512_maskz_alignr_epi32(ALL16, x, zero, 15));
+		x = _mm512_add_epi32(x, _mm512_maskz_alignr_epi32(ALL16, x, zero, 14));
+		x = _mm512_add_epi32(x, _mm512_maskz_alignr_epi32(ALL16, x, zero, 12));
+		x = _mm512_add_epi32(x, _mm512_maskz_alignr_epi32(ALL16, x, zero, 8));
+		x = _mm512_add_epi32(x, carry);
+		_mm512_storeu_si512(freqs + i, x);
+		carry = _mm512_maskz_permutexvar_epi32(ALL16, last, x);
+	}
+}
+
+AVX512_TARGET
+static void decumulateAvx512(uint32_t* freqs){
+	for (int i = 240; i > 0; i -= 16){
+		__m512i x = _mm512_loadu_si512(freqs + i);
+		__m512i below = _mm512_loadu_si512(freqs + i - 1);
+		_mm512_storeu_si512(freqs + i, _mm512_sub_epi32(x, below));
+	}
+	__m512i x = _mm512_loadu_si512(freqs);
+	_mm512_storeu_si512(freqs, _mm512_sub_epi32(x, _mm512_maskz_alignr_epi32(ALL16, x, _mm512_setzero_si512(), 15)));
+}
+
+AVX512_TARGET
+static int searchAvx512(const uint32_t* freqs, uint32_t value){
+	__m512i v = _mm512_set1_epi32(value);
+	__m512i stride = _mm512_setr_epi32(15, 31, 47, 63, 79, 95, 111, 127,
+		143, 159, 175, 191, 207, 223, 239, 255);
+	int block = __builtin_popcount(_mm512_cmplt_epu32_mask(_mm512_mask_i32gather_epi32(_mm512_setzero_si512(), ALL16, stride, freqs, 4), v));
+	if (block == 16){
+		return 0xFF;
+	}
+	return 16 * block + __builtin_popcount(_mm512_cmplt_epu32_mask(_mm512_loadu_si512(freqs + 16 * block), v));
+}
+
+AVX512_TARGET
+static bool gatherAvx512(const uint32_t* freqs, const uint8_t* src, size_t count, uint32_t* lows, uint32_t* highs){
+	__mmask16 missing = 0;
+	__m512i zero = _mm512_setzero_si512();
+	__m512i one = _mm512_set1_epi32(1);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16){
+		__m512i c = _mm512_maskz_cvtepu8_epi32(ALL16, _mm_loadu_si128((const __m128i*) (src + i)));
+		__mmask16 nonzero = _mm512_test_epi32_mask(c, c);
+		__m512i high = _mm512_mask_i32gather_epi32(zero, ALL16, c, freqs, 4);
+		__m512i low = _mm512_mask_i32gather_epi32(zero, nonzero, _mm512_sub_epi32(c, one), freqs, 4);
+		_mm512_storeu_si512(lows + i, low);
+		_mm512_storeu_si512(highs + i, high);
+		missing |= _mm512_cmpeq_epi32_mask(low, high);
+	}
+
+	return gatherScalar(freqs, src + i, count - i, lows + i, highs + i) && !missing;
+}
+
+/*
+ * The tables, from the lowest level to the highest.
+ */
+static const ArKernels kernels[] = {
+	{CPU_SCALAR, "scalar", histogramScalar, accumulateScalar, decumulateScalar, searchScalar, gatherScalar},
+	{CPU_SSE42, "sse4.2", histogramScalar, accumulateSse42, decumulateSse42, searchSse42, gatherScalar},
+	{CPU_AVX2, "avx2", histogramScalar, accumulateAvx2, decumulateAvx2, searchAvx2, gatherAvx2},
+	{CPU_AVX512, "avx512", histogramScalar, accumulateAvx512, decumulateAvx512, searchAvx512, gatherAvx512}
+};
+
+// Scalar until startup picks a table, in case other static initializers
+// use a Model first
+const ArKernels* activeKernels = &kernels[CPU_SCALAR];
+
+/*
+ * The best level that the processor supports.
+ */
+int cpuSupported(){
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd")
+			&& __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq")
+			&& __builtin_cpu_supports("avx512vl")){
+		return CPU_AVX512;
+	}
+	if (__builtin_cpu_supports("avx2")){
+		return CPU_AVX2;
+	}
+	if (__builtin_cpu_supports("sse4.2")){
+		return CPU_SSE42;
+	}
+	return CPU_SCALAR;
+}
+
+/*
+ * Looks up a level by the name used in ARC_CPU.
+ *
+ * Returns -1 if the name is not known.
+ */
+int cpuLevelByName(const char* name){
+	for (int i = CPU_SCALAR; i <= CPU_AVX512; i++){
+		if (strcmp(name, kernels[i].name) == 0){
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * The table for a level, or NULL if the processor does not support it.
+ */
+const ArKernels* getKernels(int level){
+	if (level < CPU_SCALAR || level > cpuSupported()){
+		return NULL;
+	}
+	return &kernels[level];
+}
+
+/*
+ * Switches the whole process to the table for a level. This is meant for
+ * startup and for comparing levels, since it is not synchronized with
+ * other threads.
+ *
+ * Returns false (and changes nothing) if the processor does not support
+ * the level.
+ */
+bool setKernels(int level){
+	const ArKernels* table = getKernels(level);
+	if (table == NULL){
+		return false;
+	}
+	activeKernels = table;
+	return true;
+}
+
+/*
+ * Picks the startup table: the best supported level, lowered by ARC_CPU
+ * if it is set.
+ */
+static bool chooseKernels(){
+	int level = cpuSupported();
+
+	const char* name = getenv("ARC_CPU");
+	if (name != NULL){
+		int wanted = cpuLevelByName(name);
+		if (wanted >= 0 && wanted < level){
+			level = wanted;
+		}
+	}
+
+	return setKernels(level);
+}
+
+static bool chosen = chooseKernels();
@@ -0,0 +1,58 @@
+#ifndef KERNELS_INCLUDED
+#define KERNELS_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Instruction set levels, each including the ones before it
+const int CPU_SCALAR	= 0;
+const int CPU_SSE42		= 1;
+const int CPU_AVX2		= 2;
+const int CPU_AVX512	= 3;	// F, CD, BW, DQ, and VL
+
+/*
+ * The library's vectorizable inner loops.
+ *
+ * The library is built without target flags so that it runs on any
+ * x86-64 processor. One table is chosen for the whole process at
+ * startup instead, from the best level the processor supports. The
+ * ARC_CPU environment variable (scalar, sse4.2, avx2, or avx512) can
+ * lower it, which is handy for comparing the levels or working around a
+ * bad processor.
+ *
+ * Every table gives exactly the same results as the scalar one; a level
+ * with no faster version of a kernel shares the one below it.
+ */
+struct ArKernels{
+	int level;
+	const char* name;
+
+	// Adds the number of times each byte occurs in src to counts[256]
+	void (*histogram)(const uint8_t* src, size_t count, uint32_t* counts);
+	// Turns 256 counts into running totals, in place
+	void (*accumulate)(uint32_t* freqs);
+	// Turns 256 running totals back into counts, in place
+	void (*decumulate)(uint32_t* freqs);
+	// The number of the first 255 running totals that are below value
+	int (*search)(const uint32_t* freqs, uint32_t value);
+	// Looks up the running totals before (0 for character 0) and at each
+	// character of src, into lows and highs. Returns false if any of them
+	// has a count of 0.
+	bool (*gather)(const uint32_t* freqs, const uint8_t* src, size_t count, uint32_t* lows, uint32_t* highs);
+};
+
+extern const ArKernels* activeKernels;
+
+/*
+ * The table in use.
+ */
+inline const ArKernels* getKernels(){
+	return activeKernels;
+}
+
+const ArKernels* getKernels(int level);
+bool setKernels(int level);
+int cpuSupported();
+int cpuLevelByName(const char* name);
+
+#endif
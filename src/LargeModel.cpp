@@ -0,0 +1,284 @@
+#include "LargeModel.h"
+#include "Kernels.h"
+#include "bitTwiddle.h"
+
+#include <string.h>
+
+/*
+ * Creates an empty model for symbols 0 to size - 1. The size is clamped
+ * to between 1 and LARGE_MAX_SIZE.
+ */
+LargeModel::LargeModel(uint32_t n){
+	size = n < 1 ? 1 : n > LARGE_MAX_SIZE ? LARGE_MAX_SIZE : n;
+	blocks = CEIL_DIV(size, LARGE_BLOCK);
+
+	freqs = new uint32_t*[blocks]();
+
+	// Padded so that the Kernels search can find the block when there are
+	// few enough blocks. The padding is above any total, so the search
+	// never stops in it.
+	uint32_t padded = blocks < LARGE_BLOCK ? LARGE_BLOCK : blocks;
+	ends = new uint32_t[padded];
+	for (uint32_t b = 0; b < padded; b++){
+		ends[b] = b < blocks ? 0 : ~0;
+	}
+
+	total = 0;
+	digested = false;
+}
+
+LargeModel::~LargeModel(){
+	for (uint32_t b = 0; b < blocks; b++){
+		delete[] freqs[b];
+	}
+	delete[] freqs;
+	delete[] ends;
+}
+
+/*
+ * Adds a symbol to the model.
+ *
+ * If the model has already been digested, this takes additional
+ * time.
+ */
+bool LargeModel::update(uint32_t s){
+	return update(s, 1);
+}
+
+bool LargeModel::update(uint32_t s, int count){
+	if (s >= size){
+		return false;
+	}
+
+	// Prevent exceeding 31 bits of precision
+	if (((uint32_t) 0x1 << 31) - 1 - count < total){
+		return false;
+	}
+
+	// Prevent underflow
+	uint32_t current = getCharCount(s);
+	if (count < 0 && current + count > current){
+		return false;
+	}
+	if (count == 0){
+		return true;
+	}
+
+	uint32_t b = s / LARGE_BLOCK;
+	uint32_t j = s % LARGE_BLOCK;
+	if (freqs[b] == NULL){
+		freqs[b] = new uint32_t[LARGE_BLOCK]();
+	}
+
+	total += count;
+
+	if (digested){
+		// Increment all further entries, in the block and in the block totals
+		for (uint32_t i = j; i < LARGE_BLOCK; i++){
+			freqs[b][i] += count;
+		}
+		for (uint32_t i = b; i < blocks; i++){
+			ends[i] += count;
+		}
+	} else {
+		freqs[b][j] += count;
+		ends[b] += count;
+	}
+
+	return true;
+}
+
+/*
+ * Digests the current model: each block's counts and the block totals
+ * become running totals. Digestion is required for most of the other
+ * member functions to operate.
+ *
+ * After digestion, update() takes additional time.
+ */
+void LargeModel::digest(){
+	if (digested){
+		return;
+	}
+
+	digested = true;
+
+	const ArKernels* k = getKernels();
+	for (uint32_t b = 0; b < blocks; b++){
+		if (freqs[b] != NULL){
+			k->accumulate(freqs[b]);
+		}
+	}
+
+	for (uint32_t b = 1; b < blocks; b++){
+		ends[b] += ends[b - 1];
+	}
+}
+
+/*
+ * Reverts a model to its pre-digest form.
+ */
+void LargeModel::undigest(){
+	if (!digested){
+		return;
+	}
+
+	digested = false;
+
+	const ArKernels* k = getKernels();
+	for (uint32_t b = 0; b < blocks; b++){
+		if (freqs[b] != NULL){
+			k->decumulate(freqs[b]);
+		}
+	}
+
+	for (uint32_t b = blocks - 1; b > 0; b--){
+		ends[b] -= ends[b - 1];
+	}
+}
+
+/*
+ * The total count of the symbols below s, for a digested model.
+ */
+inline uint32_t LargeModel::below(uint32_t s){
+	uint32_t b = s / LARGE_BLOCK;
+	uint32_t j = s % LARGE_BLOCK;
+	uint32_t base = b ? ends[b - 1] : 0;
+
+	if (j == 0 || freqs[b] == NULL){
+		return base;
+	}
+	return base + freqs[b][j - 1];
+}
+
+/*
+ * Calculates the upper bound of s, given the restrictions top and bot.
+ * See Model::calcUpper().
+ */
+uint32_t LargeModel::calcUpper(uint32_t s, uint32_t bot, uint32_t top){
+	digest();
+
+	// If this symbol has no slots, return the shadow "not present" value
+	uint32_t upper = s < size ? below(s + 1) : 0;
+	if (s >= size || below(s) == upper){
+		return bot + 1;
+	}
+
+	uint64_t range = (uint64_t) top + 1 - bot;
+	uint32_t offset = CEIL_DIV((upper + 1) * range, total + 1);
+
+	return bot + offset - 1;
+}
+
+/*
+ * Calculates the lower bound of s, given the restrictions top and bot.
+ * See Model::calcLower().
+ */
+uint32_t LargeModel::calcLower(uint32_t s, uint32_t bot, uint32_t top){
+	digest();
+
+	// If this symbol has no slots, return the shadow "not present" value
+	uint32_t lower = s < size ? below(s) : 0;
+	if (s >= size || below(s + 1) == lower){
+		return bot;
+	}
+
+	uint64_t range = (uint64_t) top + 1 - bot;
+	uint32_t offset = CEIL_DIV((lower + 1) * range, total + 1);
+
+	return bot + offset;
+}
+
+/*
+ * Calculates the symbol given an encoding within a certain range: first
+ * the block, from the block totals, then the symbol within it.
+ */
+uint32_t LargeModel::getChar(uint32_t enc, uint32_t bot, uint32_t top){
+	digest();
+
+	// Scale enc onto the total number of symbols seen
+	uint64_t range = (uint64_t) top + 1 - bot;
+	enc = (uint64_t) (enc - bot) * (total + 1) / range;
+
+	// The first block whose running total is not below enc
+	const ArKernels* k = getKernels();
+	uint32_t b;
+	if (blocks <= LARGE_BLOCK){
+		b = k->search(ends, enc);
+	} else {
+		int64_t upper = blocks - 1;	// Inclusive
+		int64_t lower = -1;			// Exclusive
+		while (upper > lower + 1){
+			int64_t mid = (upper + lower) / 2;
+			if (ends[mid] >= enc){
+				upper = mid;
+			} else {
+				lower = mid;
+			}
+		}
+		b = upper;
+	}
+
+	uint32_t j = 0;
+	if (freqs[b] != NULL){
+		j = k->search(freqs[b], enc - (b ? ends[b - 1] : 0));
+	}
+
+	uint32_t s = b * LARGE_BLOCK + j;
+	return s < size ? s : size - 1;
+}
+
+uint32_t LargeModel::getSize(){
+	return size;
+}
+
+uint32_t LargeModel::getTotal(){
+	return total;
+}
+
+uint32_t LargeModel::getCharCount(uint32_t s){
+	if (s >= size || freqs[s / LARGE_BLOCK] == NULL){
+		return 0;
+	}
+
+	uint32_t* f = freqs[s / LARGE_BLOCK];
+	uint32_t j = s % LARGE_BLOCK;
+	if (digested && j > 0){
+		return f[j] - f[j - 1];
+	}
+	return f[j];
+}
+
+/*
+ * Completely resets the model, and frees every block.
+ */
+void LargeModel::reset(){
+	total = 0;
+	digested = false;
+
+	for (uint32_t b = 0; b < blocks; b++){
+		delete[] freqs[b];
+		freqs[b] = NULL;
+	}
+	memset(ends, 0, sizeof(*ends) * blocks);
+}
+
+/*
+ * Halves every count, rounding up so that no symbol loses its slot.
+ * See Model::rescale().
+ */
+void LargeModel::rescale(){
+	undigest();
+
+	total = 0;
+	for (uint32_t b = 0; b < blocks; b++){
+		if (freqs[b] == NULL){
+			continue;
+		}
+		ends[b] = 0;
+		for (uint32_t j = 0; j < LARGE_BLOCK; j++){
+			freqs[b][j] = (freqs[b][j] + 1) / 2;
+			ends[b] += freqs[b][j];
+		}
+		total += ends[b];
+	}
+}
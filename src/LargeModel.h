@@ -0,0 +1,58 @@
+#ifndef LARGEMODEL_INCLUDED
+#define LARGEMODEL_INCLUDED
+
+#include <stdint.h>
+
+const uint32_t LARGE_BLOCK = 256;				// Symbols per block
+const uint32_t LARGE_MAX_SIZE = 0x1 << 24;		// Largest alphabet
+
+/*
+ * A Model for alphabets of any size up to LARGE_MAX_SIZE, such as token
+ * IDs or quantized values, coded with ArEncoder::put(LargeModel*, ...)
+ * and ArDecoder::get(LargeModel*).
+ *
+ * The counts are kept in blocks of LARGE_BLOCK symbols, with a second
+ * table of running totals over the blocks. A symbol's bounds are its
+ * block's running total plus its running total within the block, and
+ * decoding finds the block first and then the symbol within it. Blocks
+ * that have never been updated are not allocated, so sparse alphabets
+ * cost little memory.
+ *
+ * Apart from the symbol type, it behaves like Model, including the
+ * shadow "not present" slot and the 31 bit precision limit.
+ */
+class LargeModel{
+public:
+	LargeModel(uint32_t size);
+	~LargeModel();
+	LargeModel(const LargeModel&) = delete;
+	LargeModel& operator=(const LargeModel&) = delete;
+
+	bool update(uint32_t s);
+	bool update(uint32_t s, int count);
+	void digest();
+
+	uint32_t calcUpper(uint32_t s, uint32_t bot, uint32_t top);
+	uint32_t calcLower(uint32_t s, uint32_t bot, uint32_t top);
+
+	uint32_t getChar(uint32_t enc, uint32_t bot, uint32_t top);
+	uint32_t getSize();
+	uint32_t getTotal();
+	uint32_t getCharCount(uint32_t s);
+
+	void reset();
+	void rescale();
+
+private:
+	uint32_t size;
+	uint32_t blocks;
+	uint32_t** freqs;	// Per block, NULL until it has a count
+	uint32_t* ends;		// Per block total, padded to at least LARGE_BLOCK entries
+	uint32_t total;
+	bool digested;
+
+	void undigest();
+	inline uint32_t below(uint32_t s);
+};
+
+#endif
@@ -0,0 +1,376 @@
+#include "Lz.h"
+
+const int HASH_BITS = 17;
+
+const LzLevel LZ_LEVELS[LZ_MAX_LEVEL + 1] = {
+	{16, 4, 32, false},		// 0 is treated as 1
+	{16, 4, 32, false},
+	{17, 8, 32, false},
+	{18, 16, 64, false},
+	{18, 16, 64, true},
+	{19, 32, 128, true},
+	{20, 64, 128, true},
+	{21, 128, LZ_MAX_MATCH, true},
+	{22, 256, LZ_MAX_MATCH, true},
+	{22, 1024, LZ_MAX_MATCH, true}
+};
+
+/*
+ * The match finder settings for a level, clamped to the valid range.
+ */
+const LzLevel& lzLevel(int level){
+	if (level < LZ_MIN_LEVEL){
+		level = LZ_MIN_LEVEL;
+	} else if (level > LZ_MAX_LEVEL){
+		level = LZ_MAX_LEVEL;
+	}
+	return LZ_LEVELS[level];
+}
+
+static inline uint32_t hash4(const uint8_t* p){
+	uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+	return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static inline uint32_t matchLength(const uint8_t* a, const uint8_t* b, uint32_t max){
+	uint32_t len = 0;
+	while (len < max && a[len] == b[len]){
+		len++;
+	}
+	return len;
+}
+
+LzModels::LzModels(){
+	for (int i = 0; i < 3; i++){
+		for (int j = 0; j < 3; j++){
+			kinds[i].update(j);
+		}
+	}
+
+	for (int i = 0; i < 256; i++){
+		literals.update(i);
+		lengths.update(i);
+	}
+
+	// Enough slots for the largest window
+	for (int i = 0; i < LZ_DISTANCE_SLOTS; i++){
+		slots.update(i);
+	}
+
+	for (int bits = 1; bits <= 8; bits++){
+		for (int i = 0; i < (0x1 << bits); i++){
+			raw[bits].update(i);
+		}
+	}
+}
+
+/*
+ * Splits a distance into a slot and extra bits. The slot holds the
+ * position of the highest bit of dist - 1 and the bit below it, and
+ * the extra bits hold the rest.
+ */
+uint8_t LzModels::distanceSlot(uint32_t dist, int* extraBits, uint32_t* extra){
+	uint32_t d = dist - 1;
+	if (d < 4){
+		*extraBits = 0;
+		*extra = 0;
+		return d;
+	}
+
+	int top = 31 - __builtin_clz(d);
+	*extraBits = top - 1;
+	*extra = d & ((0x1 << *extraBits) - 1);
+	return 2 * top + ((d >> (top - 1)) & 0x1);
+}
+
+/*
+ * The smallest distance in a slot, minus 1.
+ */
+uint32_t LzModels::slotBase(uint8_t slot, int* extraBits){
+	if (slot < 4){
+		*extraBits = 0;
+		return slot;
+	}
+
+	int top = slot / 2;
+	*extraBits = top - 1;
+	return (uint32_t) (2 | (slot & 0x1)) << (top - 1);
+}
+
+/*
+ * Compresses with the given match finder settings, clamped to what the
+ * format allows: windows of 2 ^ LZ_MIN_WINDOW_BITS to
+ * 2 ^ LZ_MAX_WINDOW_BITS characters, a depth of at least 1, and a nice
+ * length from LZ_MIN_MATCH to LZ_MAX_MATCH. The decoder does not need
+ * to know them.
+ */
+LzEncoder::LzEncoder(std::ostream* outstream, const LzLevel& level) : are(&models.kinds[0], outstream){
+	out = outstream;
+	params = level;
+	lastKind = LZ_LITERAL;
+	windowMask = 0;
+
+	if (params.windowBits < LZ_MIN_WINDOW_BITS){
+		params.windowBits = LZ_MIN_WINDOW_BITS;
+	} else if (params.windowBits > LZ_MAX_WINDOW_BITS){
+		params.windowBits = LZ_MAX_WINDOW_BITS;
+	}
+	if (params.depth < 1){
+		params.depth = 1;
+	}
+	if (params.nice < LZ_MIN_MATCH){
+		params.nice = LZ_MIN_MATCH;
+	} else if (params.nice > LZ_MAX_MATCH){
+		params.nice = LZ_MAX_MATCH;
+	}
+}
+
+/*
+ * Compresses with the settings of a level, from LZ_MIN_LEVEL to
+ * LZ_MAX_LEVEL. A shortcut for LzEncoder(out, lzLevel(level)).
+ */
+LzEncoder::LzEncoder(std::ostream* outstream, int level) : LzEncoder(outstream, lzLevel(level)){}
+
+LzEncoder::~LzEncoder(){}
+
+/*
+ * Compresses count characters from src as one block.
+ * Returns false if out is NULL.
+ */
+bool LzEncoder::put(const uint8_t* src, uint32_t count){
+	if (out == NULL){
+		return false;
+	}
+
+	// No need for a window larger than the block
+	int bits = params.windowBits;
+	while (bits > 8 && ((uint32_t) 0x1 << (bits - 1)) >= count){
+		bits--;
+	}
+	uint32_t window = 0x1 << bits;
+	windowMask = window - 1;
+
+	head.assign(0x1 << HASH_BITS, -1);
+	prev.assign(window, -1);
+
+	lastKind = LZ_LITERAL;
+	uint32_t lastDist = 0;
+
+	uint32_t pos = 0;
+	while (pos < count){
+		uint32_t dist = 0;
+		uint32_t len = findMatch(src, count, pos, &dist, true);
+
+		// A repeat of the last distance is much cheaper than a new match
+		uint32_t repLen = 0;
+		if (lastDist > 0 && lastDist <= pos){
+			uint32_t max = count - pos < (uint32_t) LZ_MAX_MATCH ? count - pos : LZ_MAX_MATCH;
+			repLen = matchLength(src + pos, src + pos - lastDist, max);
+		}
+		if (repLen >= (uint32_t) LZ_MIN_MATCH && repLen + 1 >= len){
+			len = repLen;
+			dist = lastDist;
+		}
+
+		// Emit a literal instead if the next position has a longer match
+		if (params.lazy && len >= (uint32_t) LZ_MIN_MATCH && len < (uint32_t) params.nice && pos + 1 < count){
+			uint32_t nextDist;
+			if (findMatch(src, count, pos + 1, &nextDist, false) > len + 1){
+				len = 0;
+			}
+		}
+
+		if (len < (uint32_t) LZ_MIN_MATCH){
+			code(&models.kinds[lastKind], LZ_LITERAL);
+			code(&models.literals, src[pos]);
+			lastKind = LZ_LITERAL;
+			pos++;
+			continue;
+		}
+
+		if (dist == lastDist){
+			code(&models.kinds[lastKind], LZ_REPEAT);
+			code(&models.lengths, len - LZ_MIN_MATCH);
+			lastKind = LZ_REPEAT;
+		} else{
+			code(&models.kinds[lastKind], LZ_MATCH);
+			code(&models.lengths, len - LZ_MIN_MATCH);
+
+			int extraBits;
+			uint32_t extra;
+			code(&models.slots, LzModels::distanceSlot(dist, &extraBits, &extra));
+			codeRaw(extra, extraBits);
+
+			lastKind = LZ_MATCH;
+			lastDist = dist;
+		}
+
+		// Index the positions covered by the match
+		for (uint32_t i = 1; i < len; i++){
+			if (pos + i + LZ_MIN_MATCH <= count){
+				insert(src, pos + i);
+			}
+		}
+		pos += len;
+	}
+
+	return true;
+}
+
+/*
+ * Finishes the underlying ArEncoder. See ArEncoder::finish().
+ */
+int LzEncoder::finish(){
+	return are.finish();
+}
+
+inline void LzEncoder::code(Model* m, uint8_t c){
+	are.setModel(m);
+	are.put(c);
+	m->adapt(c);
+}
+
+/*
+ * Codes the rightmost count bits of bits with the flat Models, up to 8
+ * at a time, most significant first.
+ */
+inline void LzEncoder::codeRaw(uint32_t bits, int count){
+	while (count > 0){
+		int chunk = count % 8 ? count % 8 : 8;
+		count -= chunk;
+		are.setModel(&models.raw[chunk]);
+		are.put((bits >> count) & ((0x1 << chunk) - 1));
+	}
+}
+
+/*
+ * Finds the longest match for pos among earlier positions with the same
+ * hash, storing its distance in dist. If insert is set, pos is added to
+ * its hash chain.
+ *
+ * Returns the match length, or 0 if there is none.
+ */
+inline uint32_t LzEncoder::findMatch(const uint8_t* src, uint32_t count, uint32_t pos, uint32_t* dist, bool insertPos){
+	if (pos + LZ_MIN_MATCH > count){
+		return 0;
+	}
+
+	uint32_t max = count - pos < (uint32_t) LZ_MAX_MATCH ? count - pos : LZ_MAX_MATCH;
+	uint32_t h = hash4(src + pos);
+	int32_t cand = head[h];
+	if (insertPos){
+		prev[pos & windowMask] = cand;
+		head[h] = pos;
+	}
+
+	uint32_t best = 0;
+	int depth = params.depth;
+	while (cand >= 0 && pos - cand <= windowMask && depth-- > 0){
+		// Check the character that would extend the best match first
+		if (src[cand + best] == src[pos + best]){
+			uint32_t len = matchLength(src + pos, src + cand, max);
+			if (len > best){
+				best = len;
+				*dist = pos - cand;
+				// Nothing can beat a match that reaches the end of the
+				// block, and checking past it would read beyond src
+				if (len >= (uint32_t) params.nice || len == max){
+					break;
+				}
+			}
+		}
+
+		// Chains only ever point backwards; anything else was overwritten
+		int32_t next = prev[cand & windowMask];
+		if (next >= cand){
+			break;
+		}
+		cand = next;
+	}
+
+	return best;
+}
+
+inline void LzEncoder::insert(const uint8_t* src, uint32_t pos){
+	uint32_t h = hash4(src + pos);
+	prev[pos & windowMask] = head[h];
+	head[h] = pos;
+}
+
+LzDecoder::LzDecoder(std::istream* in) : ard(&models.kinds[0], in){}
+
+LzDecoder::~LzDecoder(){}
+
+/*
+ * Decompresses one block of count characters into dst.
+ *
+ * Returns the number of characters decoded, which is less than count
+ * only if the stream is corrupt.
+ */
+uint32_t LzDecoder::get(uint8_t* dst, uint32_t count){
+	uint8_t lastKind = LZ_LITERAL;
+	uint32_t lastDist = 0;
+
+	uint32_t pos = 0;
+	while (pos < count){
+		uint8_t kind = decode(&models.kinds[lastKind]);
+		lastKind = kind;
+
+		if (kind == LZ_LITERAL){
+			dst[pos++] = decode(&models.literals);
+			continue;
+		}
+
+		uint32_t len = decode(&models.lengths) + LZ_MIN_MATCH;
+		if (kind == LZ_MATCH){
+			uint8_t slot = decode(&models.slots);
+			if (slot >= LZ_DISTANCE_SLOTS){
+				return pos;
+			}
+
+			int extraBits;
+			uint32_t base = LzModels::slotBase(slot, &extraBits);
+			lastDist = base + decodeRaw(extraBits) + 1;
+		} else if (kind != LZ_REPEAT){
+			return pos;
+		}
+
+		if (lastDist == 0 || lastDist > pos){
+			return pos;
+		}
+
+		// Copy one character at a time, since the match may overlap itself
+		uint32_t end = pos + len < count ? pos + len : count;
+		const uint8_t* from = dst + pos - lastDist;
+		while (pos < end){
+			dst[pos++] = *from++;
+		}
+	}
+
+	return pos;
+}
+
+/*
+ * Returns the flags of the underlying ArDecoder.
+ */
+uint8_t LzDecoder::getFlags(){
+	return ard.getFlags();
+}
+
+inline uint8_t LzDecoder::decode(Model* m){
+	ard.setModel(m);
+	uint8_t c = ard.get();
+	m->adapt(c);
+	return c;
+}
+
+inline uint32_t LzDecoder::decodeRaw(int count){
+	uint32_t bits = 0;
+	while (count > 0){
+		int chunk = count % 8 ? count % 8 : 8;
+		count -= chunk;
+		ard.setModel(&models.raw[chunk]);
+		bits = (bits << chunk) | ard.get();
+	}
+	return bits;
+}
@@ -0,0 +1,107 @@
+#ifndef LZ_INCLUDED
+#define LZ_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+#include "Model.h"
+#include "ArEncoder.h"
+#include "ArDecoder.h"
+
+/*
+ * An LZ77 front end for the arithmetic coder.
+ *
+ * A hash chain match finder splits the input into literals, matches,
+ * and repeats (matches at the previous distance). Each kind of value
+ * is then coded in its own adaptive Model.
+ *
+ * Every call to LzEncoder::put() codes one block. Matches never reach
+ * outside of their block, but the Models carry over.
+ */
+
+const int LZ_MIN_MATCH = 4;
+const int LZ_MAX_MATCH = LZ_MIN_MATCH + 255;
+
+const int LZ_MIN_LEVEL = 1;
+const int LZ_MAX_LEVEL = 9;
+const int LZ_DEFAULT_LEVEL = 6;
+
+const int LZ_MIN_WINDOW_BITS = 8;
+const int LZ_MAX_WINDOW_BITS = 24;	// As many as there are distance slots for
+const int LZ_DISTANCE_SLOTS = 2 * LZ_MAX_WINDOW_BITS;
+
+// Token kinds
+const uint8_t LZ_LITERAL	= 0;
+const uint8_t LZ_MATCH		= 1;
+const uint8_t LZ_REPEAT		= 2;
+
+// Match finder settings for a compression level
+struct LzLevel{
+	int windowBits;	// Matches reach back at most 2 ^ windowBits characters
+	int depth;		// The most hash chain entries searched per position
+	int nice;		// A match this long ends the search
+	bool lazy;		// Whether to check for a better match one character later
+};
+
+const LzLevel& lzLevel(int level);
+
+/*
+ * The Models shared (in mirrored state) by LzEncoder and LzDecoder.
+ */
+class LzModels{
+public:
+	LzModels();
+
+	Model kinds[3];		// Token kind, by the previous token kind
+	Model literals;
+	Model lengths;		// Match length - LZ_MIN_MATCH
+	Model slots;		// Distance slot
+	Model raw[9];		// Flat Models for the extra bits of a distance, by bit count
+
+	static uint8_t distanceSlot(uint32_t dist, int* extraBits, uint32_t* extra);
+	static uint32_t slotBase(uint8_t slot, int* extraBits);
+};
+
+class LzEncoder{
+public:
+	LzEncoder(std::ostream* out, const LzLevel& level);
+	LzEncoder(std::ostream* out, int level);
+	~LzEncoder();
+
+	bool put(const uint8_t* src, uint32_t count);
+	int finish();
+private:
+	LzModels models;
+	ArEncoder are;
+	std::ostream* out;
+	LzLevel params;
+	uint8_t lastKind;
+
+	std::vector<int32_t> head;
+	std::vector<int32_t> prev;
+	uint32_t windowMask;
+
+	inline void code(Model* m, uint8_t c);
+	inline void codeRaw(uint32_t bits, int count);
+	inline uint32_t findMatch(const uint8_t* src, uint32_t count, uint32_t pos, uint32_t* dist, bool insert);
+	inline void insert(const uint8_t* src, uint32_t pos);
+};
+
+class LzDecoder{
+public:
+	LzDecoder(std::istream* in);
+	~LzDecoder();
+
+	uint32_t get(uint8_t* dst, uint32_t count);
+	uint8_t getFlags();
+private:
+	LzModels models;
+	ArDecoder ard;
+
+	inline uint8_t decode(Model* m);
+	inline uint32_t decodeRaw(int count);
+};
+
+#endif
@@ -0,0 +1,467 @@
+#include "Mix.h"
+
+#include <cmath>
+#include <stdint.h>
+#include <string.h>
+
+// Sizes of the direct tables, in buckets: the half byte context alone for
+// order 0, and with the previous byte for order 1
+const int ORDER0_BUCKETS = 32;
+const int ORDER1_BUCKETS = 256 * 32;
+
+const int BUCKET = 16;			// Counters per bucket; the first of a hashed bucket holds a check
+const int CONTEXTS = 6;			// Context models
+const int MATCH_INPUT = 6;
+const int BIAS_INPUT = 7;
+const uint32_t MAX_MATCH = 0xFFFF;
+const uint32_t MATCH_VERIFY = 32;	// Bytes checked backwards when a match is found
+
+const int COUNTER_LIMIT = 12;	// Context model counters adapt at 1 / (n + 1.5) until n reaches this
+const int MATCH_SHIFT = 6;
+const int APM_SHIFT = 7;
+const int MIX_RATE = 6;			// Mixer learning rate
+const int MIX_INITIAL = 0x1 << 14;
+const int32_t MIX_WEIGHT_LIMIT = (0x1 << 20) - 1;	// Keeps each weight times input within 31 bits
+
+/*
+ * The logistic function and its inverse, on 12 bit probabilities and
+ * stretched values from -2047 to 2047.
+ */
+class Logistic{
+public:
+	int16_t squashes[4096];
+	int16_t stretches[4096];
+
+	Logistic(){
+		for (int i = 0; i < 4096; i++){
+			double d = (i - 2048) / 256.0;
+			int p = (int) (4096 / (1 + exp(-d)));
+			squashes[i] = p > 4095 ? 4095 : (p < 1 ? 1 : p);
+		}
+
+		// The inverse: the smallest stretched value that squashes to at
+		// least each probability
+		int pi = 0;
+		for (int x = -2047; x <= 2047; x++){
+			int v = squash(x);
+			for (int j = pi; j <= v; j++){
+				stretches[j] = x;
+			}
+			pi = v + 1;
+		}
+		for (int j = pi; j < 4096; j++){
+			stretches[j] = 2047;
+		}
+	}
+
+	inline int squash(int d) const{
+		if (d > 2047){
+			d = 2047;
+		}
+		if (d < -2047){
+			d = -2047;
+		}
+		return squashes[d + 2048];
+	}
+
+	inline int stretch(int p) const{
+		return stretches[p];
+	}
+};
+
+static const Logistic logistic;
+
+static inline uint32_t hash(uint64_t x, int i){
+	x = (x + i + 1) * 0x9E3779B97F4A7C15ULL;
+	return (uint32_t) (x >> 32) ^ (uint32_t) x;
+}
+
+/*
+ * 65536 / (n + 1.5), the adaptation rate of a counter that has seen n
+ * bits.
+ */
+class Rates{
+public:
+	int32_t rates[16];
+
+	Rates(){
+		for (int n = 0; n < 16; n++){
+			rates[n] = (int32_t) (65536 / (n + 1.5));
+		}
+	}
+};
+
+static const Rates rates;
+
+/*
+ * Moves a context model counter towards bit. A counter is a 12 bit
+ * probability of a 1 above a 4 bit count of the bits it has seen, so a
+ * new context learns quickly and an established one settles.
+ */
+static inline void train(uint16_t* v, int bit){
+	int n = *v & 0xF;
+	int p = *v >> 4;
+	p += (((bit << 12) - bit - p) * rates.rates[n]) >> 16;
+	n += n < COUNTER_LIMIT;
+	*v = p << 4 | n;
+}
+
+/*
+ * Moves a 16 bit probability of a 1 towards bit, without a branch on
+ * the bit. It stays between 0 and 65535.
+ */
+static inline void adapt(uint16_t* p, int bit, int shift){
+	int target = (bit << 16) - bit;
+	*p += (target - *p) >> shift;
+}
+
+/*
+ * Allocates every table, at the settings the encoder and decoder share.
+ */
+MixPredictor::MixPredictor(int tableBits, bool useSse){
+	bits = tableBits < MIX_MIN_BITS ? MIX_MIN_BITS : (tableBits > MIX_MAX_BITS ? MIX_MAX_BITS : tableBits);
+	sse = useSse;
+
+	uint32_t hashed = 0x1 << bits;
+	size_t total = (size_t) (ORDER0_BUCKETS + ORDER1_BUCKETS + 4 * hashed) * BUCKET;
+
+	// 32 extra entries, so that the tables can start on a cache line
+	memory = new uint16_t[total + 32];
+	uint16_t* aligned = (uint16_t*) (((uintptr_t) memory + 63) & ~(uintptr_t) 63);
+	for (size_t i = 0; i < total; i++){
+		aligned[i] = 0x8000;
+	}
+
+	uint32_t sizes[CONTEXTS] = {(uint32_t) ORDER0_BUCKETS, (uint32_t) ORDER1_BUCKETS, hashed, hashed, hashed, hashed};
+	uint16_t* next = aligned;
+	for (int i = 0; i < CONTEXTS; i++){
+		tables[i] = next;
+		masks[i] = sizes[i] - 1;
+		hashes[i] = 0;
+		next += (size_t) sizes[i] * BUCKET;
+	}
+
+	historyMask = (0x1 << (bits + 4)) - 1;
+	history = new uint8_t[historyMask + 1];
+	memset(history, 0, historyMask + 1);
+	matchMask = hashed - 1;
+	matches = new uint32_t[hashed];
+	memset(matches, 0, hashed * sizeof(uint32_t));
+	pos = 0;
+	ptr = 0;
+	len = 0;
+	for (int i = 0; i < 64; i++){
+		matchProbs[i] = 0x8000;
+	}
+
+	for (int s = 0; s < MIX_SETS; s++){
+		for (int i = 0; i < MIX_INPUTS; i++){
+			weights[s][i] = i == BIAS_INPUT ? 0 : MIX_INITIAL;
+		}
+	}
+	for (int i = 0; i < MIX_INPUTS; i++){
+		inputs[i] = 0;
+	}
+	inputs[BIAS_INPUT] = 256;
+
+	apm = new uint16_t[65536 * 33];
+	for (int c = 0; c < 65536; c++){
+		for (int j = 0; j < 33; j++){
+			apm[c * 33 + j] = logistic.squash((j - 16) * 128) * 16;
+		}
+	}
+
+	c0 = 1;
+	bitCount = 0;
+	c8 = 0;
+	word = 0;
+	lastWord = 0;
+	mixed = 2048;
+	matchSlot = 0;
+	apmSlot = 0;
+
+	nextNibble();
+}
+
+MixPredictor::~MixPredictor(){
+	delete[] memory;
+	delete[] history;
+	delete[] matches;
+	delete[] apm;
+}
+
+/*
+ * The probability that the next bit is a 0, out of 2 ^ BIT_PROB_BITS,
+ * ready for BitModel::setProb().
+ */
+uint32_t MixPredictor::predict(){
+	int slot = nibbleSlot();
+	for (int i = 0; i < CONTEXTS; i++){
+		inputs[i] = logistic.stretch(buckets[i][slot] >> 4);
+	}
+
+	// The match model only has a say while the match agrees with the byte
+	// so far
+	if (len > 0){
+		int expected = history[ptr & historyMask] | 0x100;
+		if ((uint32_t) (expected >> (8 - bitCount)) == c0){
+			int bit = (expected >> (7 - bitCount)) & 0x1;
+			int bucket = len < 16 ? len : 16 + ((len - 16) >> 2 < 15 ? (len - 16) >> 2 : 15);
+			matchSlot = bucket * 2 + bit;
+			inputs[MATCH_INPUT] = logistic.stretch(matchProbs[matchSlot] >> 4);
+		} else{
+			len = 0;
+		}
+	}
+	if (len == 0){
+		inputs[MATCH_INPUT] = 0;
+	}
+
+	const int32_t* w = weights[mixerSet()];
+	int32_t dot = 0;
+	for (int i = 0; i < MIX_INPUTS; i++){
+		dot += (w[i] * inputs[i]) >> 8;
+	}
+	mixed = logistic.squash(dot >> 8);
+
+	int p = mixed;
+	if (sse){
+		// Interpolate between the two nearest of 33 steps along the
+		// stretched probability
+		int s = logistic.stretch(mixed) + 2048;
+		int lo = s >> 7;
+		int frac = s & 0x7F;
+		const uint16_t* t = apm + ((c8 & 0xFF) << 8 | c0) * 33;
+		int refined = (t[lo] * (128 - frac) + t[lo + 1] * frac) >> 11;
+		apmSlot = ((c8 & 0xFF) << 8 | c0) * 33 + lo + (frac >> 6);
+		p = (mixed + 3 * refined) >> 2;
+		p = p < 1 ? 1 : (p > 4095 ? 4095 : p);
+	}
+
+	return (4096 - p) << 4;
+}
+
+/*
+ * Trains every part on the bit just coded, then moves on to the next.
+ */
+void MixPredictor::update(int bit){
+	int slot = nibbleSlot();
+	for (int i = 0; i < CONTEXTS; i++){
+		train(&buckets[i][slot], bit);
+	}
+	if (len > 0){
+		adapt(&matchProbs[matchSlot], bit, MATCH_SHIFT);
+	}
+
+	int err = ((bit << 12) - mixed) * MIX_RATE;
+	int32_t* w = weights[mixerSet()];
+	for (int i = 0; i < MIX_INPUTS; i++){
+		int32_t v = w[i] + ((inputs[i] * err + 0x8000) >> 16);
+		w[i] = v > MIX_WEIGHT_LIMIT ? MIX_WEIGHT_LIMIT : (v < -MIX_WEIGHT_LIMIT ? -MIX_WEIGHT_LIMIT : v);
+	}
+
+	if (sse){
+		adapt(&apm[apmSlot], bit, APM_SHIFT);
+	}
+
+	c0 = (c0 << 1) | bit;
+	bitCount++;
+	if (bitCount == 8){
+		nextByte();
+	} else if (bitCount == 4){
+		nextNibble();
+	}
+}
+
+/*
+ * Records a finished byte, then rehashes every context and updates the
+ * match.
+ */
+void MixPredictor::nextByte(){
+	uint8_t c = c0 & 0xFF;
+	c0 = 1;
+	bitCount = 0;
+	c8 = (c8 << 8) | c;
+
+	uint8_t lower = c >= 'A' && c <= 'Z' ? c + 'a' - 'A' : c;
+	if ((lower >= 'a' && lower <= 'z') || c >= 0x80){
+		word = (word + lower + 1) * 0x3D4D51CB;
+	} else if (word){
+		lastWord = word;
+		word = 0;
+	}
+
+	hashes[0] = 0;
+	hashes[1] = c << 5;
+	hashes[2] = hash(c8 & 0xFFFF, 2);
+	hashes[3] = hash(c8 & 0xFFFFFF, 3);
+	hashes[4] = hash(c8 & 0xFFFFFFFF, 4);
+	hashes[5] = hash((uint64_t) word << 32 | lastWord, 5);
+
+	// Extend the current match, or look for a new one
+	history[pos & historyMask] = c;
+	pos++;
+	if (len > 0 && history[ptr & historyMask] == c){
+		len += len < MAX_MATCH;
+		ptr++;
+	} else{
+		len = 0;
+	}
+
+	uint32_t h = hash(c8 & 0xFFFFFFFFFFFFULL, 6) & matchMask;
+	if (len == 0 && pos >= (uint32_t) MIX_MATCH_MIN){
+		ptr = matches[h];
+		if (ptr > 0 && pos - ptr <= historyMask){
+			while (len < MATCH_VERIFY && len < ptr && len < pos - ptr
+					&& history[(ptr - len - 1) & historyMask] == history[(pos - len - 1) & historyMask]){
+				len++;
+			}
+			if (len < (uint32_t) MIX_MATCH_MIN){
+				len = 0;
+			}
+		}
+	}
+	matches[h] = pos;
+
+	nextNibble();
+}
+
+/*
+ * Finds the bucket of every context model for the next 4 bits. A hashed
+ * bucket whose check does not match belongs to another context, and is
+ * taken over.
+ */
+void MixPredictor::nextNibble(){
+	uint32_t nibble = bitCount < 4 ? 0 : 1 + (c0 & 0xF);
+
+	buckets[0] = tables[0] + nibble * BUCKET;
+	buckets[1] = tables[1] + (hashes[1] | nibble) * BUCKET;
+
+	uint16_t checks[CONTEXTS];
+	for (int i = 2; i < CONTEXTS; i++){
+		uint64_t x = (uint64_t) (hashes[i] + nibble * 0x9E3779B1) * 0xD6E8FEB86659FD93ULL;
+		buckets[i] = tables[i] + ((x >> 32) & masks[i]) * BUCKET;
+		checks[i] = x >> 16;
+		__builtin_prefetch(buckets[i]);
+	}
+
+	for (int i = 2; i < CONTEXTS; i++){
+		if (buckets[i][0] != checks[i]){
+			buckets[i][0] = checks[i];
+			for (int j = 1; j < BUCKET; j++){
+				buckets[i][j] = 0x8000;
+			}
+		}
+	}
+}
+
+/*
+ * The position of the next bit in the current half byte's bucket, from
+ * 1 to 15.
+ */
+inline int MixPredictor::nibbleSlot(){
+	int done = bitCount & 0x3;
+	return (c0 & ((0x1 << done) - 1)) | (0x1 << done);
+}
+
+MixEncoder::MixEncoder(std::ostream* outstream, int tableBits, bool sse) : pr(tableBits, sse), are(NULL, outstream){
+	out = outstream;
+}
+
+MixEncoder::~MixEncoder(){}
+
+/*
+ * Codes a character.
+ * Returns false if out is NULL.
+ */
+bool MixEncoder::put(uint8_t c){
+	if (out == NULL){
+		return false;
+	}
+
+	code(c);
+
+	return true;
+}
+
+/*
+ * Codes count characters from src.
+ * Returns false if out is NULL.
+ */
+bool MixEncoder::put(const uint8_t* src, size_t count){
+	if (out == NULL){
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++){
+		code(src[i]);
+	}
+
+	return true;
+}
+
+/*
+ * Finishes the underlying ArEncoder. See ArEncoder::finish().
+ */
+int MixEncoder::finish(){
+	return are.finish();
+}
+
+inline void MixEncoder::code(uint8_t c){
+	for (int i = 7; i >= 0; i--){
+		int bit = (c >> i) & 0x1;
+		bm.setProb(pr.predict());
+		are.put(&bm, bit);
+		pr.update(bit);
+	}
+}
+
+MixDecoder::MixDecoder(std::istream* in, int tableBits, bool sse) : pr(tableBits, sse), ard(NULL, in){}
+
+MixDecoder::~MixDecoder(){}
+
+/*
+ * Decodes a character. Like ArDecoder, it does not know when to stop.
+ */
+uint8_t MixDecoder::get(){
+	return decode();
+}
+
+/*
+ * Decodes exactly count characters into dst.
+ * Returns the number of characters decoded.
+ */
+size_t MixDecoder::get(uint8_t* dst, size_t count){
+	for (size_t i = 0; i < count; i++){
+		dst[i] = decode();
+	}
+
+	return count;
+}
+
+/*
+ * See ArDecoder::getFlags(). MODEL_NULL is left out, since the bits are
+ * never coded with a Model.
+ */
+uint8_t MixDecoder::getFlags(){
+	return ard.getFlags() & ~MODEL_NULL;
+}
+
+inline uint8_t MixDecoder::decode(){
+	int c = 0;
+	for (int i = 0; i < 8; i++){
+		bm.setProb(pr.predict());
+		int bit = ard.get(&bm);
+		pr.update(bit);
+		c = (c << 1) | bit;
+	}
+	return c;
+}
+
+/*
+ * The mixer's weight set, by the length of the match (which decides how
+ * far to trust the match model) and the position in the byte.
+ */
+inline int MixPredictor::mixerSet(){
+	return (len < 15 ? len : 15) * 8 + bitCount;
+}
@@ -0,0 +1,133 @@
+#ifndef MIX_INCLUDED
+#define MIX_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "BitModel.h"
+#include "ArEncoder.h"
+#include "ArDecoder.h"
+
+/*
+ * A context mixing front end for the arithmetic coder, for data where
+ * ratio matters far more than speed, such as cold archives.
+ *
+ * Each byte is coded as 8 bits, most significant first. For every bit,
+ * several predictors each give a probability of a 1:
+ *   - order 0 to 4 context models, keyed by the last 0 to 4 bytes
+ *   - a word model, keyed by the current and previous words of letters
+ *   - a match model, which finds the last occurrence of the preceding
+ *     MIX_MATCH_MIN bytes and predicts the byte that followed it
+ * A small logistic mixer, with a set of weights for each match length
+ * and bit position, combines them in the stretched domain and learns
+ * online which to trust. An optional secondary estimation stage then
+ * refines the mixed probability by the partial byte and the byte before
+ * it. The result is coded with ArEncoder::put(BitModel*, ...).
+ *
+ * The context model tables hold a 32 byte bucket of 16 bit counters per
+ * context and half byte, so each model touches a single cache line per
+ * 4 bits. All of the buckets a half byte needs are
+ * looked up together, so their misses overlap.
+ *
+ * The encoder and decoder must be given the same settings.
+ */
+
+const int MIX_INPUTS = 8;			// The 7 predictors and a bias
+const int MIX_SETS = 16 * 8;		// Mixer weight sets, by match length and bit position
+const int MIX_MIN_BITS = 10;
+const int MIX_MAX_BITS = 22;
+const int MIX_DEFAULT_BITS = 18;	// 2 ^ 18 buckets, 8 MB, per hashed context model
+const int MIX_MATCH_MIN = 6;		// Bytes of context a match must share
+
+/*
+ * The predictors and mixer shared (in mirrored state) by MixEncoder and
+ * MixDecoder. tableBits sets the size of the hashed tables, clamped to
+ * between MIX_MIN_BITS and MIX_MAX_BITS; memory use is about
+ * 2 ^ tableBits * 148 bytes, plus 4 MB.
+ */
+class MixPredictor{
+public:
+	MixPredictor(int tableBits, bool sse);
+	~MixPredictor();
+
+	uint32_t predict();
+	void update(int bit);
+private:
+	int bits;
+	bool sse;
+
+	uint16_t* memory;			// Every context model table, 64 byte aligned
+	uint16_t* tables[6];		// Orders 0 to 4, then words
+	uint32_t masks[6];
+	uint16_t* buckets[6];		// The bucket of each for the current half byte
+	uint32_t hashes[6];			// Each context, hashed at the start of the byte
+
+	// The byte so far, with a leading 1, and the last 8 whole bytes
+	uint32_t c0;
+	int bitCount;
+	uint64_t c8;
+	uint32_t word;
+	uint32_t lastWord;
+
+	// Match model
+	uint8_t* history;
+	uint32_t historyMask;
+	uint32_t* matches;		// Where each hashed MIX_MATCH_MIN bytes of context last ended
+	uint32_t matchMask;
+	uint32_t pos;
+	uint32_t ptr;
+	uint32_t len;
+	uint16_t matchProbs[64];	// By length bucket and expected bit
+
+	// Mixer
+	int32_t weights[MIX_SETS][MIX_INPUTS];
+	int inputs[MIX_INPUTS];
+	int mixed;					// Its prediction, 12 bit
+	int matchSlot;
+
+	// Secondary estimation, by c0 and the previous byte, 33 steps each
+	uint16_t* apm;
+	int apmSlot;
+
+	void nextByte();
+	void nextNibble();
+	inline int nibbleSlot();
+	inline int mixerSet();
+};
+
+class MixEncoder{
+public:
+	MixEncoder(std::ostream* out, int tableBits = MIX_DEFAULT_BITS, bool sse = true);
+	~MixEncoder();
+
+	bool put(uint8_t c);
+	bool put(const uint8_t* src, size_t count);
+	int finish();
+private:
+	MixPredictor pr;
+	BitModel bm;
+	ArEncoder are;
+	std::ostream* out;
+
+	inline void code(uint8_t c);
+};
+
+class MixDecoder{
+public:
+	MixDecoder(std::istream* in, int tableBits = MIX_DEFAULT_BITS, bool sse = true);
+	~MixDecoder();
+
+	uint8_t get();
+	size_t get(uint8_t* dst, size_t count);
+	uint8_t getFlags();
+private:
+	MixPredictor pr;
+	BitModel bm;
+	ArDecoder ard;
+
+	inline uint8_t decode();
+};
+
+#endif
@@ -1,10 +1,10 @@
 #include "Model.h"
+#include "Kernels.h"
+#include "bitTwiddle.h"
 
 #include <iostream>
 #include <cmath>
 
-#define CEIL_DIV(x, y)	((x) / (y) + ((x) % (y) ? 1 : 0))
-
 Model::Model(){
 	total = 0;
 	digested = false;
@@ -48,6 +48,37 @@ bool Model::update(uint8_t c, int count){
 	return true;
 }
 
+/*
+ * Adds count characters to the model at once, which is much faster than
+ * calling update() for each of them.
+ *
+ * If the characters would violate the 31 bit precision limits, none of
+ * them are added and this returns false.
+ */
+bool Model::ingest(const uint8_t* src, size_t count){
+	if (count > ((uint32_t) 0x1 << 31) - 1 - total){
+		return false;
+	}
+
+	undigest();
+	getKernels()->histogram(src, count, freqs);
+	total += count;
+
+	return true;
+}
+
+/*
+ * Records an occurrence of c in an adaptive model: adds step to its
+ * count, halving the model first if the total would pass limit. Coders
+ * and decoders that make the same calls keep their models mirrored.
+ */
+void Model::adapt(uint8_t c, int step, uint32_t limit){
+	if (total + step > limit){
+		rescale();
+	}
+	update(c, step);
+}
+
 /*
  * Digests the current model. 
  * Digestion is required for most of the other member functions
@@ -63,9 +94,7 @@ void Model::digest(){
 	digested = true;
 
 	// Accumulate the frequencies
-	for (int i = 1; i < 256; i++){
-		freqs[i] += freqs[i - 1];
-	}
+	getKernels()->accumulate(freqs);
 }
 
 /*
@@ -82,9 +111,7 @@ void Model::undigest(){
 	digested = false;
 
 	// Decumulate the frequencies
-	for (int i = 255; i > 0; i--){
-		freqs[i] -= freqs[i - 1];
-	}
+	getKernels()->decumulate(freqs);
 }
 
 /*
@@ -157,25 +184,26 @@ uint8_t Model::getChar(uint32_t enc, uint32_t bot, uint32_t top){
 	uint64_t range = (uint64_t)top + 1 - bot;
 	enc = (uint64_t)(enc - bot) * (total + 1) / range;
 
-	// Binary search freqs for the closest value > c
-	int upper = 0xFF;	// Inclusive
-	int lower = -1; 	// Exclusive
-	int mid;
-
-	// A 1 is added to the entries to account for a shadow "not present" value at 0
-	while (upper > lower + 1){
-		mid = (upper + lower) / 2;
-		if (freqs[mid] + 1 > enc){
-			upper = mid;
-		} else if (freqs[mid] + 1 < enc){
-			lower = mid;
-		} else{
-			lower = mid;
-		}
-	}
+	// Find the first entry whose value + 1 is > enc, where the 1 accounts
+	// for the shadow "not present" value at 0. The index directly
+	// corresponds to the symbol.
+	return getKernels()->search(freqs, enc);
+}
 
-	// The index directly corresponds to the symbol
-	return upper;
+/*
+ * Looks up the bounds of count characters from src at once, before any
+ * of them are coded, into lows and highs: the running totals below and
+ * at each character. These are what calcLower() and calcUpper() scale,
+ * so a static model's lookups can be done ahead of the coder.
+ *
+ * If the model has not already been digested, gather() digests it first.
+ *
+ * Returns false if any of the characters has no slot, in which case
+ * they must go through calcUpper() and calcLower() for the shadow value.
+ */
+bool Model::gather(const uint8_t* src, size_t count, uint32_t* lows, uint32_t* highs){
+	digest();
+	return getKernels()->gather(freqs, src, count, lows, highs);
 }
 
 uint32_t Model::getTotal(){
@@ -189,6 +217,27 @@ uint32_t Model::getCharCount(uint8_t c){
 	return freqs[c];
 }
 
+/*
+ * The sum of the counts of c and every character below it.
+ *
+ * If the model has not already been digested, this digests it first.
+ */
+uint32_t Model::getRunningTotal(uint8_t c){
+	digest();
+	return freqs[c];
+}
+
+/*
+ * The first character whose running total is not below value, which is
+ * what getChar() looks up once enc is scaled onto the total.
+ *
+ * If the model has not already been digested, this digests it first.
+ */
+uint8_t Model::search(uint32_t value){
+	digest();
+	return getKernels()->search(freqs, value);
+}
+
 double Model::getEntropy(){
 	undigest();
 	double prob, entropy = 0;
@@ -199,6 +248,33 @@ double Model::getEntropy(){
 	return entropy;
 }
 
+/*
+ * The average number of bits per character it would take to code
+ * characters with the given 256 counts using this model. Returns
+ * INFINITY if one of the characters has no slot.
+ *
+ * The model is left as it was, digested or not.
+ */
+double Model::getCrossEntropy(const uint32_t* counts){
+	double bits = 0;
+	uint64_t n = 0;
+	for (int i = 0; i < 256; i++){
+		if (counts[i] == 0){
+			continue;
+		}
+
+		uint32_t freq = getCharCount(i);
+		if (freq == 0){
+			return INFINITY;
+		}
+
+		// Every character shares the range with the shadow slot
+		bits -= counts[i] * log2((double) freq / (total + 1));
+		n += counts[i];
+	}
+	return n ? bits / n : 0;
+}
+
 /*
  * Completely resets the model.
  */
@@ -211,6 +287,83 @@ void Model::reset(){
 	}	
 }
 
+/*
+ * Resets the model to a single count for every character, which is
+ * where adaptive coding starts.
+ */
+void Model::flatten(){
+	reset();
+	for (int i = 0; i < 256; i++){
+		freqs[i] = 1;
+	}
+	total = 256;
+}
+
+/*
+ * Halves every count, rounding up so that no character loses its slot.
+ * This keeps adaptive models within the precision limits and lets them
+ * favour recent characters.
+ *
+ * The model is always undigested afterwards.
+ */
+void Model::rescale(){
+	undigest();
+
+	total = 0;
+	for (int i = 0; i < 256; i++){
+		freqs[i] = (freqs[i] + 1) / 2;
+		total += freqs[i];
+	}
+}
+
+/*
+ * Scales the counts into norm (256 entries) so that they add up to
+ * exactly 2 ^ bits, for coders that need a power of two total. Every
+ * character with a nonzero count keeps at least one slot.
+ *
+ * Returns false if the model is empty or bits is not between 8 and 24.
+ */
+bool Model::normalize(uint32_t* norm, int bits){
+	if (total == 0 || bits < 8 || bits > 24){
+		return false;
+	}
+
+	uint64_t target = (uint64_t) 0x1 << bits;
+	uint64_t sum = 0;
+	int largest = 0;
+	for (int i = 0; i < 256; i++){
+		uint32_t count = getCharCount(i);
+		norm[i] = count * target / total;
+		if (count > 0 && norm[i] == 0){
+			norm[i] = 1;
+		}
+		sum += norm[i];
+		if (count > getCharCount(largest)){
+			largest = i;
+		}
+	}
+
+	// Rounding down leaves slots over, which go to the most common character
+	if (sum < target){
+		norm[largest] += target - sum;
+		return true;
+	}
+
+	// Rounding rare characters up to 1 can overshoot, so take from the largest
+	while (sum > target){
+		int most = 0;
+		for (int i = 1; i < 256; i++){
+			if (norm[i] > norm[most]){
+				most = i;
+			}
+		}
+		norm[most]--;
+		sum--;
+	}
+
+	return true;
+}
+
 /*
  * Writes the current model to an output stream.
  *
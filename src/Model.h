@@ -1,10 +1,15 @@
 #pragma once
 
 #include <iosfwd>
+#include <stddef.h>
 #include <stdint.h>
 
 class Bitstream;
 
+// Adaptive Models gain ADAPT_STEP per character and are halved past ADAPT_LIMIT
+const int ADAPT_STEP = 24;
+const uint32_t ADAPT_LIMIT = 0x1 << 16;
+
 class Model{
 public:
 	Model();
@@ -12,17 +17,26 @@ public:
 
 	bool update(uint8_t c);
 	bool update(uint8_t c, int count);
+	bool ingest(const uint8_t* src, size_t count);
+	void adapt(uint8_t c, int step = ADAPT_STEP, uint32_t limit = ADAPT_LIMIT);
 	void digest();
 
 	uint32_t calcUpper(uint8_t c, uint32_t bot, uint32_t top);
 	uint32_t calcLower(uint8_t c, uint32_t bot, uint32_t top);
 
 	uint8_t getChar(uint32_t enc, uint32_t bot, uint32_t top);
+	bool gather(const uint8_t* src, size_t count, uint32_t* lows, uint32_t* highs);
 	uint32_t getTotal();
 	uint32_t getCharCount(uint8_t c);
+	uint32_t getRunningTotal(uint8_t c);
+	uint8_t search(uint32_t value);
 	double getEntropy();
+	double getCrossEntropy(const uint32_t* counts);
 
 	void reset();
+	void flatten();
+	void rescale();
+	bool normalize(uint32_t* norm, int bits);
 
 	void exportModel(std::ostream& out);
 	void importModel(std::istream& in);
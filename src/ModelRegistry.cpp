@@ -0,0 +1,219 @@
+#include "ModelRegistry.h"
+#include "Kernels.h"
+
+#include <cmath>
+#include <iterator>
+#include <string.h>
+
+const char REGISTRY_MAGIC[4] = {'A', 'r', 'C', 'r'};
+
+// The cost given to a character with no slot, which makes a Model that
+// lacks the characters of a block a poor choice without ruling it out
+const float MISSING_COST = 32;
+
+ModelRegistry::ModelRegistry(){}
+
+ModelRegistry::~ModelRegistry(){
+	clear();
+}
+
+/*
+ * Adds a copy of m under id. Later changes to m have no effect on the
+ * registry.
+ *
+ * Returns false if m is NULL or empty, or id is already in use.
+ */
+bool ModelRegistry::add(uint32_t id, Model* m){
+	if (m == NULL || m->getTotal() == 0 || find(id) >= 0){
+		return false;
+	}
+
+	Entry* e = new Entry();
+	e->id = id;
+
+	uint32_t total = m->getTotal();
+	for (int i = 0; i < 256; i++){
+		uint32_t freq = m->getCharCount(i);
+		e->model.update(i, freq);
+		e->costs[i] = freq ? -log2((double) freq / (total + 1)) : MISSING_COST;
+	}
+	e->model.digest();
+
+	entries.push_back(e);
+	return true;
+}
+
+/*
+ * Writes every Model in the registry format.
+ * Returns false if out is not good.
+ */
+bool ModelRegistry::save(std::ostream& out){
+	uint32_t count = entries.size();
+	out.write(REGISTRY_MAGIC, sizeof(REGISTRY_MAGIC));
+	out.put((char) REGISTRY_VERSION);
+	for (int i = 0; i < 3; i++){
+		out.put(0);
+	}
+	out.write((char*) &count, sizeof(count));
+
+	for (size_t i = 0; i < entries.size(); i++){
+		Entry* e = entries[i];
+		out.write((char*) &e->id, sizeof(e->id));
+		for (int c = 0; c < 256; c++){
+			uint32_t freq = e->model.getCharCount(c);
+			out.write((char*) &freq, sizeof(freq));
+		}
+	}
+
+	return out.good();
+}
+
+/*
+ * Replaces the registry with copies of the Models in a registry file.
+ * data is only read during the call, so it can be freed afterwards.
+ *
+ * Returns false, leaving the registry empty, if the file is malformed.
+ */
+bool ModelRegistry::load(const void* data, size_t size){
+	clear();
+
+	const uint8_t* p = (const uint8_t*) data;
+	const size_t header = sizeof(REGISTRY_MAGIC) + 4 + sizeof(uint32_t);
+	const size_t record = sizeof(uint32_t) * 257;
+
+	if (p == NULL || size < header || memcmp(p, REGISTRY_MAGIC, sizeof(REGISTRY_MAGIC)) != 0
+			|| p[sizeof(REGISTRY_MAGIC)] > REGISTRY_VERSION){
+		return false;
+	}
+
+	uint32_t count;
+	memcpy(&count, p + header - sizeof(count), sizeof(count));
+	if ((size - header) / record < count){
+		return false;
+	}
+
+	Model m;
+	uint32_t record32[257];
+	for (uint32_t i = 0; i < count; i++){
+		memcpy(record32, p + header + i * record, record);
+
+		m.reset();
+		for (int c = 0; c < 256; c++){
+			if (!m.update(c, record32[1 + c])){
+				clear();
+				return false;
+			}
+		}
+
+		if (!add(record32[0], &m)){
+			clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Reads a whole registry file from in. See load(const void*, size_t).
+ */
+bool ModelRegistry::load(std::istream& in){
+	std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	return load(data.data(), data.size());
+}
+
+int ModelRegistry::getCount(){
+	return entries.size();
+}
+
+/*
+ * The index of the Model with the given id, or -1 if there is none.
+ */
+int ModelRegistry::find(uint32_t id){
+	for (size_t i = 0; i < entries.size(); i++){
+		if (entries[i]->id == id){
+			return i;
+		}
+	}
+	return -1;
+}
+
+uint32_t ModelRegistry::getId(int index){
+	return entries[index]->id;
+}
+
+/*
+ * The Model at index. It is digested, and must not be changed.
+ */
+Model* ModelRegistry::getModel(int index){
+	return &entries[index]->model;
+}
+
+/*
+ * Picks the Model expected to code src in the fewest bits, judging by
+ * its first REGISTRY_SAMPLE characters.
+ * Returns its index, or -1 if the registry is empty.
+ */
+int ModelRegistry::choose(const uint8_t* src, size_t count){
+	uint32_t counts[256] = {0};
+	getKernels()->histogram(src, count < REGISTRY_SAMPLE ? count : REGISTRY_SAMPLE, counts);
+	return choose(counts);
+}
+
+/*
+ * Picks the Model that would code characters with the given 256 counts
+ * in the fewest bits.
+ * Returns its index, or -1 if the registry is empty.
+ */
+int ModelRegistry::choose(const uint32_t* counts){
+	float histogram[256];
+	for (int i = 0; i < 256; i++){
+		histogram[i] = counts[i];
+	}
+
+	int best = -1;
+	float bestCost = INFINITY;
+	for (size_t i = 0; i < entries.size(); i++){
+		// Separate sums, so that the compiler can keep them in one vector
+		const float* costs = entries[i]->costs;
+		float sums[8] = {0};
+		for (int c = 0; c < 256; c += 8){
+			for (int k = 0; k < 8; k++){
+				sums[k] += histogram[c + k] * costs[c + k];
+			}
+		}
+
+		float cost = 0;
+		for (int k = 0; k < 8; k++){
+			cost += sums[k];
+		}
+
+		if (cost < bestCost){
+			bestCost = cost;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+/*
+ * Whether the Model at index has a slot for every character with a
+ * nonzero count, so that they all survive coding.
+ */
+bool ModelRegistry::covers(int index, const uint32_t* counts){
+	Model* m = &entries[index]->model;
+	for (int i = 0; i < 256; i++){
+		if (counts[i] && m->getCharCount(i) == 0){
+			return false;
+		}
+	}
+	return true;
+}
+
+void ModelRegistry::clear(){
+	for (size_t i = 0; i < entries.size(); i++){
+		delete entries[i];
+	}
+	entries.clear();
+}
@@ -0,0 +1,73 @@
+#ifndef MODELREGISTRY_INCLUDED
+#define MODELREGISTRY_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Model.h"
+
+/*
+ * Registry file format
+ *
+ * Header:			'A' 'r' 'C' 'r' <version> 0 0 0 <models>
+ * Each model:		<id> <counts>
+ *
+ * models and id are 32 bit values, and counts is 256 32 bit counts. All
+ * fields are 4 byte aligned. load() copies the counts into Models of the
+ * registry's own, which it digests and prices, so the file is only read
+ * while loading and need not outlive the registry.
+ */
+
+const uint8_t REGISTRY_VERSION = 1;
+
+const size_t REGISTRY_SAMPLE = 4096;	// Characters of a block looked at by choose()
+
+/*
+ * A set of frozen Models, each known by an ID that can be stored in a
+ * stream in place of the Model itself.
+ *
+ * choose() picks the Model that would code a block in the fewest bits.
+ * It takes a histogram of the start of the block and weighs it against
+ * a table of per character costs kept for each Model, which is one short
+ * dot product per Model.
+ *
+ * Once loaded, the Models are digested and never change, so they can be
+ * shared by decoders on separate threads.
+ */
+class ModelRegistry{
+public:
+	ModelRegistry();
+	~ModelRegistry();
+	ModelRegistry(const ModelRegistry&) = delete;
+	ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+	bool add(uint32_t id, Model* m);
+	bool save(std::ostream& out);
+	bool load(const void* data, size_t size);
+	bool load(std::istream& in);
+
+	int getCount();
+	int find(uint32_t id);
+	uint32_t getId(int index);
+	Model* getModel(int index);
+
+	int choose(const uint8_t* src, size_t count);
+	int choose(const uint32_t* counts);
+	bool covers(int index, const uint32_t* counts);
+private:
+	// A frozen Model and the cost of each character in it, in bits
+	struct Entry{
+		uint32_t id;
+		Model model;
+		float costs[256];
+	};
+
+	std::vector<Entry*> entries;
+
+	void clear();
+};
+
+#endif
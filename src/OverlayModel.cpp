@@ -0,0 +1,273 @@
+#include "OverlayModel.h"
+#include "Model.h"
+#include "bitTwiddle.h"
+
+/*
+ * Creates an overlay on base. See reset().
+ */
+OverlayModel::OverlayModel(Model* b){
+	copy = NULL;
+	reset(b);
+}
+
+OverlayModel::OverlayModel(const OverlayModel& other){
+	copy = NULL;
+	*this = other;
+}
+
+/*
+ * Copies other's counts, which snapshots a stream so that it can be
+ * forked or rewound. The base is shared, and only a copied base is
+ * copied again.
+ */
+OverlayModel& OverlayModel::operator=(const OverlayModel& other){
+	if (this == &other){
+		return *this;
+	}
+
+	delete copy;
+	copy = other.copy ? new Model(*other.copy) : NULL;
+	base = other.base;
+	total = other.total;
+	entries = other.entries;
+	for (int i = 0; i < entries; i++){
+		chars[i] = other.chars[i];
+		adds[i] = other.adds[i];
+	}
+
+	return *this;
+}
+
+OverlayModel::~OverlayModel(){
+	delete copy;
+}
+
+/*
+ * Starts again from base, dropping every update. base is digested here
+ * if it is not already, so digest it before sharing it between threads;
+ * after that it is only read, and any number of overlays on any number
+ * of threads may share it. It must outlive them.
+ *
+ * With no base, the overlay is an empty adaptive Model of its own.
+ */
+void OverlayModel::reset(Model* b){
+	delete copy;
+	copy = NULL;
+	base = b;
+	entries = 0;
+
+	if (base == NULL){
+		copy = new Model();
+		total = 0;
+		return;
+	}
+
+	base->digest();
+	total = base->getTotal();
+}
+
+/*
+ * Adds a character to the model.
+ */
+bool OverlayModel::update(uint8_t c){
+	return update(c, 1);
+}
+
+/*
+ * Adds count to c's count. A negative count can only take away what has
+ * been added since reset(), never the base's counts.
+ *
+ * Returns false, without changing anything, if the update would violate
+ * the 31 bit precision limits or take away more than was added.
+ */
+bool OverlayModel::update(uint8_t c, int count){
+	if (copy != NULL){
+		if (!copy->update(c, count)){
+			return false;
+		}
+		total = copy->getTotal();
+		return true;
+	}
+
+	// Prevent exceeding 31 bits of precision
+	if (count > 0 && ((uint32_t) 0x1 << 31) - 1 - count < total){
+		return false;
+	}
+
+	int i = 0;
+	while (i < entries && chars[i] < c){
+		i++;
+	}
+
+	if (i < entries && chars[i] == c){
+		if (count < 0 && adds[i] < (uint32_t) -count){
+			return false;
+		}
+		if (count > 0 && adds[i] + (uint32_t) count > OVERLAY_MAX_ADD){
+			copyBase();
+			return update(c, count);
+		}
+		adds[i] += count;
+		total += count;
+		return true;
+	}
+
+	if (count < 0){
+		return false;
+	}
+	if (count == 0){
+		return true;
+	}
+
+	if (entries == OVERLAY_ENTRIES || (uint32_t) count > OVERLAY_MAX_ADD){
+		copyBase();
+		return update(c, count);
+	}
+
+	// Keep the list in order of character
+	for (int j = entries; j > i; j--){
+		chars[j] = chars[j - 1];
+		adds[j] = adds[j - 1];
+	}
+	chars[i] = c;
+	adds[i] = count;
+	entries++;
+	total += count;
+
+	return true;
+}
+
+/*
+ * Calculates the upper bound of c, given the restrictions top and bot.
+ * See Model::calcUpper().
+ */
+uint32_t OverlayModel::calcUpper(uint8_t c, uint32_t bot, uint32_t top){
+	if (copy != NULL){
+		return copy->calcUpper(c, bot, top);
+	}
+
+	uint32_t prev, high;
+	bounds(c, &prev, &high);
+	if (prev == high){
+		return bot + 1;
+	}
+
+	uint64_t range = (uint64_t) top + 1 - bot;
+	uint32_t offset = CEIL_DIV((high + 1) * range, total + 1);
+	return bot + offset - 1;
+}
+
+/*
+ * Calculates the lower bound of c, given the restrictions top and bot.
+ * See Model::calcLower().
+ */
+uint32_t OverlayModel::calcLower(uint8_t c, uint32_t bot, uint32_t top){
+	if (copy != NULL){
+		return copy->calcLower(c, bot, top);
+	}
+
+	uint32_t prev, high;
+	bounds(c, &prev, &high);
+	if (prev == high){
+		return bot;
+	}
+
+	uint64_t range = (uint64_t) top + 1 - bot;
+	uint32_t offset = CEIL_DIV((prev + 1) * range, total + 1);
+	return bot + offset;
+}
+
+/*
+ * Calculates the character given an encoding within a certain range.
+ * See Model::getChar().
+ *
+ * Between two changed characters, the running totals are the base's
+ * plus what was added below, so one search of the base finds the
+ * character once the list has been walked to the right gap.
+ */
+uint8_t OverlayModel::getChar(uint32_t enc, uint32_t bot, uint32_t top){
+	if (copy != NULL){
+		return copy->getChar(enc, bot, top);
+	}
+
+	uint64_t range = (uint64_t) top + 1 - bot;
+	uint32_t value = (uint64_t) (enc - bot) * (total + 1) / range;
+
+	// Find the first character whose running total is not below value
+	uint32_t added = 0;
+	int first = 0;
+	for (int i = 0; i < entries; i++){
+		if (base->getRunningTotal(chars[i]) + added + adds[i] >= value){
+			int c = base->search(value > added ? value - added : 0);
+			c = c < first ? first : c;
+			return c < chars[i] ? c : chars[i];
+		}
+		added += adds[i];
+		first = chars[i] + 1;
+	}
+
+	int c = base->search(value > added ? value - added : 0);
+	return c < first ? first : c;
+}
+
+uint32_t OverlayModel::getTotal(){
+	return total;
+}
+
+uint32_t OverlayModel::getCharCount(uint8_t c){
+	if (copy != NULL){
+		return copy->getCharCount(c);
+	}
+
+	uint32_t count = base->getCharCount(c);
+	for (int i = 0; i < entries && chars[i] <= c; i++){
+		if (chars[i] == c){
+			count += adds[i];
+		}
+	}
+	return count;
+}
+
+/*
+ * Whether the overlay has copied its base, which it does once more than
+ * OVERLAY_ENTRIES characters have changed or one has been added to more
+ * than OVERLAY_MAX_ADD times.
+ */
+bool OverlayModel::isCopied(){
+	return copy != NULL;
+}
+
+/*
+ * The bytes this overlay holds, not counting the shared base.
+ */
+size_t OverlayModel::getSize(){
+	return sizeof(*this) + (copy ? sizeof(Model) : 0);
+}
+
+/*
+ * The running totals below and at c, which are the base's plus
+ * everything added below and at c, in one walk of the list.
+ */
+inline void OverlayModel::bounds(uint8_t c, uint32_t* low, uint32_t* high){
+	uint32_t below = 0;
+	int i = 0;
+	for (; i < entries && chars[i] < c; i++){
+		below += adds[i];
+	}
+	uint32_t at = i < entries && chars[i] == c ? adds[i] : 0;
+
+	*high = base->getRunningTotal(c) + below + at;
+	*low = *high - base->getCharCount(c) - at;
+}
+
+/*
+ * Copies the base into a Model of the overlay's own and adds the list
+ * to it, for when the list is full or an addition will not fit.
+ */
+void OverlayModel::copyBase(){
+	copy = new Model(*base);
+	for (int i = 0; i < entries; i++){
+		copy->update(chars[i], adds[i]);
+	}
+	entries = 0;
+}
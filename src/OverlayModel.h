@@ -0,0 +1,69 @@
+#ifndef OVERLAYMODEL_INCLUDED
+#define OVERLAYMODEL_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Model;
+
+const int OVERLAY_ENTRIES = 64;	// Characters changed before the base is copied
+const uint32_t OVERLAY_MAX_ADD = 0xFFFF;	// Added to one character before the base is copied
+
+/*
+ * An adaptive Model that starts from a shared, pretrained base Model
+ * instead of a flat one, coded with ArEncoder::put(OverlayModel*, ...)
+ * and ArDecoder::get(OverlayModel*).
+ *
+ * The base is never written to. Updates are kept as a short list of the
+ * characters that have changed and how much they have been added to, in
+ * order of character, and the bounds are the base's running totals plus
+ * the additions below. So starting a stream costs a few stores rather
+ * than a copy of the base, and an overlay is a few hundred bytes rather
+ * than a Model's kilobyte.
+ *
+ * Once more than OVERLAY_ENTRIES characters have changed, or one has
+ * been added to more than OVERLAY_MAX_ADD times, the overlay copies the
+ * base into a Model of its own, adds the list to it, and carries on
+ * with that. A long stream pays for the copy once; short ones, which
+ * are what priming helps, never do.
+ *
+ * A base counted from a lot of data should be scaled down first (see
+ * Model::normalize()), or each update will be too small a part of the
+ * total to matter. Its streams are interchangeable with those of a
+ * Model holding the same counts.
+ */
+class OverlayModel{
+public:
+	OverlayModel(Model* base = NULL);
+	OverlayModel(const OverlayModel& other);
+	OverlayModel& operator=(const OverlayModel& other);
+	~OverlayModel();
+
+	void reset(Model* base);
+
+	bool update(uint8_t c);
+	bool update(uint8_t c, int count);
+
+	uint32_t calcUpper(uint8_t c, uint32_t bot, uint32_t top);
+	uint32_t calcLower(uint8_t c, uint32_t bot, uint32_t top);
+
+	uint8_t getChar(uint32_t enc, uint32_t bot, uint32_t top);
+	uint32_t getTotal();
+	uint32_t getCharCount(uint8_t c);
+
+	bool isCopied();
+	size_t getSize();
+
+private:
+	Model* base;
+	Model* copy;		// The base and the list added together, once the list is full
+	uint32_t total;
+	int entries;
+	uint8_t chars[OVERLAY_ENTRIES];		// In order
+	uint16_t adds[OVERLAY_ENTRIES];
+
+	inline void bounds(uint8_t c, uint32_t* low, uint32_t* high);
+	void copyBase();
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "ShiftModel.h"
+#include "Model.h"
+
+#include <cmath>
+#include <string.h>
+
+/*
+ * An empty ShiftModel, in which every character has only the shadow
+ * slot. build() must be called before it is useful.
+ */
+ShiftModel::ShiftModel(){
+	bits = SHIFT_MIN_BITS;
+	for (int i = 0; i < 257; i++){
+		lows[i] = 1;
+	}
+	memset(slots, 0, sizeof(slots));
+}
+
+/*
+ * Scales the counts of m to a total of 2 ^ bits (clamped to between
+ * SHIFT_MIN_BITS and SHIFT_MAX_BITS), one slot of which is the shadow.
+ * Every character m has a count for keeps at least one slot. m is not
+ * modified.
+ *
+ * Returns false, leaving the ShiftModel as it was, if m is NULL or
+ * empty.
+ */
+bool ShiftModel::build(Model* m, int scale){
+	if (m == NULL){
+		return false;
+	}
+
+	scale = scale < SHIFT_MIN_BITS ? SHIFT_MIN_BITS : (scale > SHIFT_MAX_BITS ? SHIFT_MAX_BITS : scale);
+
+	uint32_t norm[256];
+	if (!m->normalize(norm, scale)){
+		return false;
+	}
+
+	// Give one slot of the most common character to the shadow. It has
+	// at least 2 ^ scale / 256 of them, so it keeps some.
+	int largest = 0;
+	for (int i = 1; i < 256; i++){
+		if (norm[i] > norm[largest]){
+			largest = i;
+		}
+	}
+	norm[largest]--;
+
+	bits = scale;
+	lows[0] = 1;
+	slots[0] = 0;
+	for (int i = 0; i < 256; i++){
+		lows[i + 1] = lows[i] + norm[i];
+		memset(slots + lows[i], i, norm[i]);
+	}
+
+	return true;
+}
+
+int ShiftModel::getBits(){
+	return bits;
+}
+
+/*
+ * The number of slots c has, out of 2 ^ getBits().
+ */
+uint32_t ShiftModel::getCharCount(uint8_t c){
+	return lows[c + 1] - lows[c];
+}
+
+/*
+ * The average number of bits per character it would take to code
+ * characters with the given 256 counts using this model. Returns
+ * INFINITY if one of the characters has no slot.
+ */
+double ShiftModel::getCrossEntropy(const uint32_t* counts){
+	double total = (double) (0x1 << bits);
+	double sum = 0;
+	uint64_t n = 0;
+	for (int i = 0; i < 256; i++){
+		if (counts[i] == 0){
+			continue;
+		}
+
+		uint32_t freq = getCharCount(i);
+		if (freq == 0){
+			return INFINITY;
+		}
+
+		sum -= counts[i] * log2(freq / total);
+		n += counts[i];
+	}
+	return n ? sum / n : 0;
+}
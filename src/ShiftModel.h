@@ -0,0 +1,71 @@
+#ifndef SHIFTMODEL_INCLUDED
+#define SHIFTMODEL_INCLUDED
+
+#include <stdint.h>
+
+class Model;
+
+const int SHIFT_MIN_BITS = 12;
+const int SHIFT_MAX_BITS = 16;
+const int SHIFT_DEFAULT_BITS = 12;	// 4 KB of slots, which stays in the L1 cache
+
+/*
+ * A static Model with its counts scaled to a total of exactly 2 ^ bits,
+ * coded with ArEncoder::put(ShiftModel*, ...) and
+ * ArDecoder::get(ShiftModel*).
+ *
+ * Since the total is a power of two, scaling a bound onto the coder's
+ * range is a multiply and a shift, instead of the divisions by total + 1
+ * that Model needs. Decoding finds the slot under the coder's value with
+ * one division by the range, then reads the character straight out of a
+ * table of every slot, instead of searching the running totals.
+ *
+ * The price is a little ratio, since the counts are rounded to 2 ^ bits
+ * and every present character keeps at least one slot. It is built from
+ * a Model, and does not change until it is built again.
+ *
+ * It has the same shadow "not present" slot as Model (slot 0), but its
+ * streams are not interchangeable with Model's.
+ */
+class ShiftModel{
+public:
+	ShiftModel();
+
+	bool build(Model* m, int bits = SHIFT_DEFAULT_BITS);
+
+	/*
+	 * Characters without a slot are given the shadow slot, like Model.
+	 */
+	inline uint32_t calcUpper(uint8_t c, uint32_t bot, uint32_t top){
+		uint64_t range = (uint64_t) top + 1 - bot;
+		uint32_t high = lows[c + 1] > lows[c] ? lows[c + 1] : 1;
+		return bot + (uint32_t) ((high * range) >> bits) - 1;
+	}
+
+	inline uint32_t calcLower(uint8_t c, uint32_t bot, uint32_t top){
+		uint64_t range = (uint64_t) top + 1 - bot;
+		uint32_t low = lows[c + 1] > lows[c] ? lows[c] : 0;
+		return bot + (uint32_t) ((low * range) >> bits);
+	}
+
+	/*
+	 * The slot holding enc is the last one whose lower bound is at or
+	 * below it, which works out to the one division below.
+	 */
+	inline uint8_t getChar(uint32_t enc, uint32_t bot, uint32_t top){
+		uint64_t range = (uint64_t) top + 1 - bot;
+		uint64_t slot = ((((uint64_t) enc - bot + 1) << bits) - 1) / range;
+		return slots[slot];
+	}
+
+	int getBits();
+	uint32_t getCharCount(uint8_t c);
+	double getCrossEntropy(const uint32_t* counts);
+
+private:
+	int bits;
+	uint32_t lows[257];		// The first slot of each character, then 2 ^ bits
+	uint8_t slots[0x1 << SHIFT_MAX_BITS];	// The character in each slot
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "WideArDecoder.h"
+#include "WideModel.h"
+
+
+WideArDecoder::WideArDecoder(WideModel* model, std::istream* instream){
+	m = model;
+
+	start(instream);
+	if (m == NULL){
+		flags |= MODEL_NULL;
+	}
+}
+
+WideArDecoder::~WideArDecoder(){}
+
+uint8_t WideArDecoder::get(){
+	if (flags & MODEL_NULL){
+		return 0;
+	}
+
+	uint8_t c = m->getChar(cur, bot, top);
+
+	uint64_t tmp = top;
+	top = m->calcUpper(c, bot, top);
+	bot = m->calcLower(c, bot, tmp);
+
+	converge();
+
+	return c;
+}
@@ -0,0 +1,24 @@
+#ifndef WIDE_ARDE_INCLUDED
+#define WIDE_ARDE_INCLUDED
+
+#include <stdint.h>
+#include "ArCore.h"
+
+class WideModel;
+
+/*
+ * The 64 bit counterpart of ArDecoder. Uses a WideModel and reads its
+ * input in 64 bit words. Shares the flags of ArDecoder, and sync()
+ * matches WideArEncoder::flush().
+ */
+class WideArDecoder : public ArDecoderCore<uint64_t>{
+public:
+	WideArDecoder(WideModel* m, std::istream* in);
+	~WideArDecoder();
+
+	uint8_t get();
+private:
+	WideModel* m;
+};
+
+#endif
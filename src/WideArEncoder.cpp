@@ -0,0 +1,28 @@
+#include "WideArEncoder.h"
+#include "WideModel.h"
+
+WideArEncoder::WideArEncoder(WideModel* model, std::ostream* outstream){
+	m = model;
+	start(outstream);
+}
+
+WideArEncoder::~WideArEncoder(){}
+
+/*
+ * Encodes a character. 
+ * If m or out are NULL, returns false and does not encode. 
+ * Otherwise, returns true.
+ */
+bool WideArEncoder::put(uint8_t c){
+	if (m == NULL || out == NULL){
+		return false;
+	}
+
+	uint64_t tmp = top;
+	top = m->calcUpper(c, bot, top);
+	bot = m->calcLower(c, bot, tmp);
+
+	converge();
+
+	return true;
+}
@@ -0,0 +1,24 @@
+#ifndef WIDE_AREN_INCLUDED
+#define WIDE_AREN_INCLUDED
+
+#include <stdint.h>
+#include "ArCore.h"
+
+class WideModel;
+
+/*
+ * The 64 bit counterpart of ArEncoder. Uses a WideModel and writes its
+ * output in 64 bit words. finish(), flush(), saveState(), and
+ * loadState() are those of ArEncoder, on 64 bit words.
+ */
+class WideArEncoder : public ArEncoderCore<uint64_t>{
+public:
+	WideArEncoder(WideModel* m, std::ostream* out);
+	~WideArEncoder();
+
+	bool put(uint8_t c);
+private:
+	WideModel* m;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include "WideModel.h"
+#include "bitTwiddle.h"
+
+#include <iostream>
+#include <cmath>
+
+// Largest total that keeps every slot inside a 62 bit interval
+const uint64_t WIDE_TOTAL_LIMIT = ((uint64_t) 0x1 << 62) - 1;
+
+WideModel::WideModel(){
+	total = 0;
+	digested = false;
+
+	for (int i = 0; i < 256; i++){
+		freqs[i] = 0;
+	}
+}
+
+/*
+ * Adds a character to the model. 
+ *
+ * If the model has already been digested, this takes additional
+ * time.
+ */
+bool WideModel::update(uint8_t c){
+	return update(c, 1);
+}
+
+bool WideModel::update(uint8_t c, int64_t count){
+	// Prevent exceeding 62 bits of precision
+	if (count > 0 && WIDE_TOTAL_LIMIT - (uint64_t) count < total){
+		return false;
+	}
+
+	// Prevent underflow
+	if (count < 0 && freqs[c] + count > freqs[c]){
+		return false;
+	}
+
+	freqs[c] += count;		// Increment the character's frequency
+	total += count;			// Increment the total size
+
+	if (digested){
+		// Increment all further entries
+		for (int i = c + 1; i < 256; i++){
+			freqs[i] += count;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Digests the current model. 
+ * Digestion is required for most of the other member functions
+ * to operate.
+ *
+ * After digestion, update() takes additional time.
+ */
+void WideModel::digest(){
+	if (digested){
+		return;
+	}
+
+	digested = true;
+
+	// Accumulate the frequencies
+	for (int i = 1; i < 256; i++){
+		freqs[i] += freqs[i - 1];
+	}
+}
+
+/*
+ * Reverts a model to its pre-digest form.
+ */
+void WideModel::undigest(){
+	if (!digested){
+		return;
+	}
+
+	digested = false;
+
+	// Decumulate the frequencies
+	for (int i = 255; i > 0; i--){
+		freqs[i] -= freqs[i - 1];
+	}
+}
+
+/*
+ * Calculates the upper bound of c, given the restrictions top and bot.
+ *
+ * Identical to Model::calcUpper(), but the products are carried out in
+ * 128 bits so that neither the range nor the counts need to be truncated.
+ */
+uint64_t WideModel::calcUpper(uint8_t c, uint64_t bot, uint64_t top){
+	digest();
+
+	uint64_t prev = c ? freqs[c - 1] : 0;
+	// If this character has no slots, return the shadow "not present" value
+	if (prev == freqs[c]){
+		return bot + 1;
+	}
+
+	// The true range: bot and top are inclusive
+	uint128_t range = (uint128_t) top + 1 - bot;
+
+	// Add 1 for the shadow "not present" value at 0
+	uint128_t offset = CEIL_DIV((freqs[c] + 1) * range, (uint128_t) total + 1);
+
+	// -1 to keep the encoder inclusive
+	return (uint64_t) (bot + offset - 1);
+}
+
+/*
+ * Calculates the lower bound of c, given the restrictions top and bot.
+ */
+uint64_t WideModel::calcLower(uint8_t c, uint64_t bot, uint64_t top){
+	digest();
+
+	uint64_t prev = c ? freqs[c - 1] : 0;
+	// If this character has no slots, return the shadow "not present" value
+	if (prev == freqs[c]){
+		return bot;
+	}
+
+	// The true range: bot and top are inclusive
+	uint128_t range = (uint128_t) top + 1 - bot;
+
+	// Add 1 to prev to account for the shadow "not present" value
+	uint128_t offset = CEIL_DIV((prev + 1) * range, (uint128_t) total + 1);
+
+	return (uint64_t) (bot + offset);
+}
+
+/*
+ * Calculates the character given an encoding within a certain range.
+ */
+uint8_t WideModel::getChar(uint64_t enc, uint64_t bot, uint64_t top){
+	digest();
+
+	// Scale enc onto the total number of characters seen
+	uint128_t range = (uint128_t) top + 1 - bot;
+	enc = (uint64_t) ((uint128_t) (enc - bot) * (total + 1) / range);
+
+	// Binary search freqs for the closest value > c
+	int upper = 0xFF;	// Inclusive
+	int lower = -1; 	// Exclusive
+	int mid;
+
+	// A 1 is added to the entries to account for a shadow "not present" value at 0
+	while (upper > lower + 1){
+		mid = (upper + lower) / 2;
+		if (freqs[mid] + 1 > enc){
+			upper = mid;
+		} else{
+			lower = mid;
+		}
+	}
+
+	return upper;
+}
+
+uint64_t WideModel::getTotal(){
+	return total;
+}
+
+uint64_t WideModel::getCharCount(uint8_t c){
+	if (digested && c > 0){
+		return freqs[c] - freqs[c - 1];
+	}
+	return freqs[c];
+}
+
+double WideModel::getEntropy(){
+	undigest();
+	double prob, entropy = 0;
+	for (int i = 1; i < 256; i++){
+		prob = (double)freqs[i] / total;
+		entropy -= prob ? prob * log2(prob) : 0;
+	}
+	return entropy;
+}
+
+/*
+ * Completely resets the model.
+ */
+void WideModel::reset(){
+	total = 0;
+	digested = false;
+	for (int i = 0; i < 256; i++){
+		freqs[i] = 0;
+	}	
+}
+
+/*
+ * Writes the current model to an output stream, in the same layout
+ * as Model::exportModel() but with 64 bit counts.
+ *
+ * The model is always undigested afterwards.
+ */
+void WideModel::exportModel(std::ostream& out){
+	undigest();
+
+	out.write((char*)&total, sizeof(total));
+
+	// Encode frequencies other than NULL (0)
+	for (int i = 1; i < 256; i++){
+		if (freqs[i] > 0){
+			out.put((char) i);
+			out.write((char*)(freqs + i), sizeof(*freqs));
+		}
+	}
+
+	// NULL is always encoded (and at the end)
+	out.put(0);
+	out.write((char*)&freqs[0], sizeof(*freqs));
+}
+
+/*
+ * Loads a model from an input stream.
+ *
+ * The model is always undigested afterwards.
+ * No error checking.
+ */
+void WideModel::importModel(std::istream& in){
+	reset();
+
+	in.read((char*)&total, sizeof(total));
+
+	char c = 1;
+
+	// While can read from in and NULL has not been read
+	while (c != 0 && in.good()){
+		in.get(c);
+		in.read((char*)(freqs + (uint8_t)c), sizeof(*freqs));
+	}
+}
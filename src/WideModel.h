@@ -0,0 +1,43 @@
+#pragma once
+
+#include <iosfwd>
+#include <stdint.h>
+
+// 128 bit intermediate products for the 64 bit interval math
+__extension__ typedef unsigned __int128 uint128_t;
+
+/*
+ * A Model with 64 bit counts, for use with WideArEncoder and WideArDecoder.
+ *
+ * Behaves exactly like Model, but the total may grow up to 2 ^ 62 - 1
+ * before any rescaling is needed.
+ */
+class WideModel{
+public:
+	WideModel();
+	~WideModel(){}
+
+	bool update(uint8_t c);
+	bool update(uint8_t c, int64_t count);
+	void digest();
+
+	uint64_t calcUpper(uint8_t c, uint64_t bot, uint64_t top);
+	uint64_t calcLower(uint8_t c, uint64_t bot, uint64_t top);
+
+	uint8_t getChar(uint64_t enc, uint64_t bot, uint64_t top);
+	uint64_t getTotal();
+	uint64_t getCharCount(uint8_t c);
+	double getEntropy();
+
+	void reset();
+
+	void exportModel(std::ostream& out);
+	void importModel(std::istream& in);
+
+private:
+	uint64_t freqs[256]; // range of uint_8
+	uint64_t total;
+	bool digested;
+
+	void undigest();
+};
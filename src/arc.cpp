@@ -0,0 +1,173 @@
+#include "arc.h"
+#include "Kernels.h"
+#include "Model.h"
+#include "ArPushEncoder.h"
+#include "ArPushDecoder.h"
+
+#include <new>
+
+static_assert(sizeof(Model) <= sizeof(arc_model), "arc_model is too small to hold a Model");
+static_assert(sizeof(ArPushEncoder) <= sizeof(arc_scratch), "arc_scratch is too small to hold an ArPushEncoder");
+static_assert(sizeof(ArPushDecoder) <= sizeof(arc_scratch), "arc_scratch is too small to hold an ArPushDecoder");
+
+/*
+ * The Model living in an arc_model. arc_model_init() always leaves it
+ * digested, which is the only state in which the calc functions do not
+ * modify it, so handing it out from a const arc_model is safe.
+ */
+static inline Model* modelOf(const arc_model* model){
+	return reinterpret_cast<Model*>(const_cast<arc_model*>(model));
+}
+
+/*
+ * Builds a model from a table of counts. If counts is NULL, every
+ * character gets a single slot.
+ */
+arc_status arc_model_init(arc_model* model, const uint32_t counts[256]){
+	if (model == NULL){
+		return ARC_ERR_NULL;
+	}
+
+	Model* m = new (model) Model();
+	for (int i = 0; i < 256; i++){
+		uint32_t count = counts ? counts[i] : 1;
+		if (count > 0 && (count > 0x7FFFFFFF || !m->update(i, count))){
+			return ARC_ERR_MODEL;
+		}
+	}
+	m->digest();
+
+	return ARC_OK;
+}
+
+/*
+ * Builds a model that perfectly represents src.
+ */
+arc_status arc_model_from_data(arc_model* model, const uint8_t* src, size_t n){
+	if (model == NULL || (src == NULL && n > 0)){
+		return ARC_ERR_NULL;
+	}
+
+	if (n > 0x7FFFFFFF){
+		return ARC_ERR_MODEL;
+	}
+
+	uint32_t counts[256] = {0};
+	getKernels()->histogram(src, n, counts);
+
+	return arc_model_init(model, counts);
+}
+
+uint32_t arc_model_count(const arc_model* model, uint8_t c){
+	return model ? modelOf(model)->getCharCount(c) : 0;
+}
+
+/*
+ * The most bytes that arc_encode() can write for n characters.
+ *
+ * A character narrows the interval to at least its share of a range
+ * wider than 2^30, and each halving of the interval costs one bit, so
+ * the rarest encodable character bounds the bits per character. NULL
+ * is always encodable, through the shadow slot if it has no count.
+ * The final 32 bits of bot follow, padded out to a whole word.
+ */
+size_t arc_encode_bound(const arc_model* model, size_t n){
+	int perChar = 31;	// An interval of width 2, the shadow slot
+
+	if (model != NULL){
+		Model* m = modelOf(model);
+		uint64_t total = m->getTotal();
+		uint32_t least = 0;
+		for (int i = 0; i < 256; i++){
+			uint32_t count = m->getCharCount(i);
+			if (count > 0 && (least == 0 || count < least)){
+				least = count;
+			}
+		}
+
+		uint64_t width = least * ((uint64_t) 0x1 << 30) / (total + 1);
+		if (m->getCharCount(0) > 0 && width >= 2){
+			perChar = 32 - (63 - __builtin_clzll(width));
+		}
+	}
+
+	uint64_t bits = (uint64_t) n * perChar + 32;
+	return (bits + 31) / 32 * 4;
+}
+
+/*
+ * Encodes n characters from src into dst, which has room for cap bytes.
+ * On success, the number of bytes used is stored in written.
+ *
+ * Nothing beyond written bytes of dst is touched, so cap may be smaller
+ * than arc_encode_bound() when the output is known to be small.
+ */
+arc_status arc_encode(const arc_model* model, const uint8_t* src, size_t n,
+		uint8_t* dst, size_t cap, size_t* written, arc_scratch* scratch){
+	if (model == NULL || (src == NULL && n > 0) || dst == NULL || written == NULL || scratch == NULL){
+		return ARC_ERR_NULL;
+	}
+
+	Model* m = modelOf(model);
+	ArPushEncoder* are = new (scratch) ArPushEncoder(m);
+	are->setOutput(dst, cap);
+
+	*written = 0;
+	for (size_t i = 0; i < n; i++){
+		// Characters without a slot would decode as NULL
+		if (src[i] != 0 && m->getCharCount(src[i]) == 0){
+			return ARC_ERR_SYMBOL;
+		}
+
+		if (!are->put(src[i])){
+			return ARC_ERR_DST_TOO_SMALL;
+		}
+	}
+
+	if (!are->finish()){
+		return ARC_ERR_DST_TOO_SMALL;
+	}
+
+	*written = are->produced();
+	return ARC_OK;
+}
+
+/*
+ * Decodes exactly n characters from the len bytes at src into dst.
+ */
+arc_status arc_decode(const arc_model* model, const uint8_t* src, size_t len,
+		uint8_t* dst, size_t n, arc_scratch* scratch){
+	if (model == NULL || (src == NULL && len > 0) || (dst == NULL && n > 0) || scratch == NULL){
+		return ARC_ERR_NULL;
+	}
+
+	ArPushDecoder* ard = new (scratch) ArPushDecoder(modelOf(model));
+	ard->feed(src, len);
+	ard->finish();
+	ard->get(dst, n);
+
+	// A complete stream never needs bits past its end
+	if (ard->getFlags() & STREAM_NOT_GOOD){
+		return ARC_ERR_SRC_TRUNCATED;
+	}
+
+	return ARC_OK;
+}
+
+const char* arc_strerror(arc_status status){
+	switch(status){
+		case ARC_OK:
+			return "success";
+		case ARC_ERR_NULL:
+			return "a required pointer was NULL";
+		case ARC_ERR_MODEL:
+			return "the counts exceed the 31 bit precision limit";
+		case ARC_ERR_SYMBOL:
+			return "a character has no slot in the model";
+		case ARC_ERR_DST_TOO_SMALL:
+			return "the output did not fit in dst";
+		case ARC_ERR_SRC_TRUNCATED:
+			return "the input ended before all characters were decoded";
+	}
+	return "unknown error";
+}
@@ -0,0 +1,55 @@
+#ifndef ARC_C_INCLUDED
+#define ARC_C_INCLUDED
+
+/*
+ * Flat C interface to ArC for coding whole buffers.
+ *
+ * Every object is a plain struct owned by the caller, so models and
+ * scratch space may live on the stack, in a pool, or in shared memory.
+ * No function allocates.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum arc_status{
+	ARC_OK					= 0,
+	ARC_ERR_NULL			= -1,	/* A required pointer was NULL */
+	ARC_ERR_MODEL			= -2,	/* The counts exceed the 31 bit precision limit */
+	ARC_ERR_SYMBOL			= -3,	/* A character has no slot in the model */
+	ARC_ERR_DST_TOO_SMALL	= -4,	/* The output did not fit in dst */
+	ARC_ERR_SRC_TRUNCATED	= -5	/* src ended before all characters were decoded */
+} arc_status;
+
+/* Storage for a digested Model */
+typedef struct arc_model{
+	uint32_t opaque[260];
+} arc_model;
+
+/* Storage for the coder state of one arc_encode() or arc_decode() call */
+typedef struct arc_scratch{
+	uint64_t opaque[16];
+} arc_scratch;
+
+arc_status arc_model_init(arc_model* model, const uint32_t counts[256]);
+arc_status arc_model_from_data(arc_model* model, const uint8_t* src, size_t n);
+uint32_t arc_model_count(const arc_model* model, uint8_t c);
+
+size_t arc_encode_bound(const arc_model* model, size_t n);
+
+arc_status arc_encode(const arc_model* model, const uint8_t* src, size_t n,
+	uint8_t* dst, size_t cap, size_t* written, arc_scratch* scratch);
+arc_status arc_decode(const arc_model* model, const uint8_t* src, size_t len,
+	uint8_t* dst, size_t n, arc_scratch* scratch);
+
+const char* arc_strerror(arc_status status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
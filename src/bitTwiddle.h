@@ -6,4 +6,7 @@
 #define SELECT_BIT(b, x)	( (x) & (0x1 << (b)) )
 #define	SELECT_BIT_FRONT(b, x)	( (x) & (0x1 << (sizeof(x) * 8 - (b))) )
 
-#endif
\ No newline at end of file
+// x / y, rounded up
+#define CEIL_DIV(x, y)	((x) / (y) + ((x) % (y) ? 1 : 0))
+
+#endif
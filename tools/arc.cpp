@@ -0,0 +1,511 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+
+#include "ArFrame.h"
+#include "Lz.h"
+#include "Mix.h"
+#include "ModelRegistry.h"
+
+/*
+ * arc: a command line compressor built on the framed stream format.
+ *
+ * The input is cut into blocks, each of which becomes one frame, so
+ * blocks are coded and decoded on separate threads and the output is
+ * an ordinary framed stream that any ArFrameReader can read.
+ */
+
+const size_t DEFAULT_BLOCK = 1 << 20;
+const size_t MAX_BLOCK = 0x1 << 30;		// Frames claiming more symbols, or a longer payload, are taken as corrupt
+const int DEFAULT_LEVEL = 6;
+
+struct Engine{
+	const char* name;
+	uint8_t id;
+	const char* about;
+};
+
+const Engine engines[] = {
+	{"adaptive",	ENGINE_ADAPTIVE,	"order-0, updated after every byte"},
+	{"deferred",	ENGINE_DEFERRED,	"order-0, updated once per interval (shorter at higher levels)"},
+	{"huffman",		ENGINE_HUFFMAN,		"canonical Huffman, the fastest to decode"},
+	{"lz",			ENGINE_LZ77,		"LZ77, with the match finder set by the level (default)"},
+	{"bwt",			ENGINE_BWT,			"block sorting, for text"},
+	{"mix",			ENGINE_MIX,			"context mixing, the smallest and slowest (larger tables at higher levels)"},
+	{"registered",	ENGINE_REGISTERED,	"the best Model of a registry given with -r"}
+};
+const int engineCount = sizeof(engines) / sizeof(engines[0]);
+
+struct Settings{
+	uint8_t engine;
+	int level;
+	int threads;
+	size_t block;
+	ModelRegistry* reg;
+};
+
+struct Stats{
+	uint64_t in;
+	uint64_t out;
+	uint64_t frames[256];
+	double seconds;
+};
+
+void printHelpMsg();
+int findEngine(const std::string& name);
+const char* engineName(uint8_t id);
+size_t parseSize(const char* s);
+
+bool encodeBlock(const Settings* s, const uint8_t* src, size_t count, std::string* dst);
+bool compress(const Settings& s, std::istream& in, std::ostream& out, Stats* stats);
+bool decompress(const Settings& s, std::istream& in, std::ostream& out, Stats* stats);
+int bench(const Settings& s, std::istream& in, bool all);
+void printStats(const Stats& stats, bool decoding);
+
+int main(int argc, char** argv){
+	std::ios::sync_with_stdio(false);
+
+	Settings s;
+	s.engine = ENGINE_LZ77;
+	s.level = DEFAULT_LEVEL;
+	s.threads = 1;
+	s.block = DEFAULT_BLOCK;
+	s.reg = NULL;
+
+	bool d = false;
+	bool doBench = false;
+	bool doStats = false;
+	bool allEngines = false;
+	std::string registryFile;
+
+	const struct option longOpts[] = {
+		{"compress",	no_argument,		NULL, 'c'},
+		{"decompress",	no_argument,		NULL, 'd'},
+		{"engine",		required_argument,	NULL, 'e'},
+		{"threads",		required_argument,	NULL, 'T'},
+		{"block",		required_argument,	NULL, 'B'},
+		{"registry",	required_argument,	NULL, 'r'},
+		{"bench",		no_argument,		NULL, 'b'},
+		{"stats",		no_argument,		NULL, 's'},
+		{"help",		no_argument,		NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+
+	int opt;
+	opterr = 0;
+	while ((opt = getopt_long(argc, argv, "cde:T:B:r:h123456789", longOpts, NULL)) != -1){
+		switch(opt){
+			case 'c':
+				d = false;
+				break;
+			case 'd':
+				d = true;
+				break;
+			case 'e':
+				if (std::string(optarg) == "all"){
+					allEngines = true;
+				} else{
+					int e = findEngine(optarg);
+					if (e < 0){
+						std::cerr << "arc: unknown engine '" << optarg << "'\n";
+						return 1;
+					}
+					s.engine = e;
+				}
+				break;
+			case 'T':
+				s.threads = atoi(optarg);
+				if (s.threads < 1){
+					s.threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+				}
+				break;
+			case 'B':
+				s.block = parseSize(optarg);
+				if (s.block < 1 || s.block > MAX_BLOCK){
+					std::cerr << "arc: block size must be between 1 and 1G\n";
+					return 1;
+				}
+				break;
+			case 'r':
+				registryFile = optarg;
+				break;
+			case 'b':
+				doBench = true;
+				break;
+			case 's':
+				doStats = true;
+				break;
+			case 'h':
+				printHelpMsg();
+				return 0;
+			case '?':
+				std::cerr << "arc: unknown option\n";
+				printHelpMsg();
+				return 1;
+			default:
+				if (opt >= '1' && opt <= '9'){
+					s.level = opt - '0';
+				}
+				break;
+		}
+	}
+
+	if (allEngines && !doBench){
+		std::cerr << "arc: '-e all' is only for --bench\n";
+		return 1;
+	}
+
+	// USAGE OF LIBRARY
+	ModelRegistry reg;
+	if (!registryFile.empty()){
+		std::ifstream rfs(registryFile.c_str(), std::ios::binary);
+		if (!rfs.good() || !reg.load(rfs)){
+			std::cerr << "arc: cannot load registry " << registryFile << "\n";
+			return 1;
+		}
+		s.reg = &reg;
+	} else if (s.engine == ENGINE_REGISTERED && !allEngines){
+		std::cerr << "arc: the registered engine needs a registry (-r)\n";
+		return 1;
+	}
+	// END USAGE OF LIBRARY
+
+	// Files, or standard input and output for "-" or when left out
+	std::ifstream ifs;
+	std::ofstream ofs;
+	std::istream* in = &std::cin;
+	std::ostream* out = &std::cout;
+	if (optind < argc && std::string(argv[optind]) != "-"){
+		ifs.open(argv[optind], std::ios::binary);
+		if (!ifs.good()){
+			std::cerr << "arc: cannot open " << argv[optind] << "\n";
+			return 1;
+		}
+		in = &ifs;
+	}
+	if (!doBench && optind + 1 < argc && std::string(argv[optind + 1]) != "-"){
+		ofs.open(argv[optind + 1], std::ios::binary);
+		if (!ofs.good()){
+			std::cerr << "arc: cannot open " << argv[optind + 1] << "\n";
+			return 1;
+		}
+		out = &ofs;
+	}
+
+	if (doBench){
+		return bench(s, *in, allEngines);
+	}
+
+	Stats stats;
+	memset(&stats, 0, sizeof(stats));
+	bool ok = d ? decompress(s, *in, *out, &stats) : compress(s, *in, *out, &stats);
+	out->flush();
+
+	if (doStats){
+		printStats(stats, d);
+	}
+	if (!ok || !out->good()){
+		std::cerr << "arc: " << (d ? "not an ArC stream, corrupt, cut short, or needs a registry (-r)" : "a block could not be coded, or the write failed") << "\n";
+		return 1;
+	}
+
+	return 0;
+}
+
+void printHelpMsg(){
+	std::cerr << "Usage: arc [options] [input [output]]\n";
+	std::cerr << "Reads standard input and writes standard output when files are left out or \"-\".\n";
+	std::cerr << "Options:";
+	std::cerr << "\n	-c, --compress		compress (the default)";
+	std::cerr << "\n	-d, --decompress	decompress";
+	std::cerr << "\n	-e, --engine NAME	the engine to compress with";
+	std::cerr << "\n	-1 ... -9		the level, where the engine has one (default " << DEFAULT_LEVEL << ")";
+	std::cerr << "\n	-T, --threads N		code N blocks at once (0 for one per core)";
+	std::cerr << "\n	-B, --block SIZE	bytes per block, with an optional K or M (default 1M)";
+	std::cerr << "\n	-r, --registry FILE	a ModelRegistry file, for the registered engine";
+	std::cerr << "\n	--stats			print sizes, bits per byte, and speed when done";
+	std::cerr << "\n	--bench			compress and decompress the input in memory and report; with -e all, every engine";
+	std::cerr << "\n	-h, --help		show this message";
+	std::cerr << "\nEngines:";
+	for (int i = 0; i < engineCount; i++){
+		std::cerr << "\n	" << engines[i].name << "\t" << engines[i].about;
+	}
+	std::cerr << "\n";
+}
+
+int findEngine(const std::string& name){
+	for (int i = 0; i < engineCount; i++){
+		if (name == engines[i].name){
+			return engines[i].id;
+		}
+	}
+	return -1;
+}
+
+const char* engineName(uint8_t id){
+	for (int i = 0; i < engineCount; i++){
+		if (engines[i].id == id){
+			return engines[i].name;
+		}
+	}
+	if (id == ENGINE_STORED){
+		return "stored";
+	}
+	return id == ENGINE_STATIC ? "static" : "unknown";
+}
+
+/*
+ * A size in bytes, with an optional K or M suffix. Returns 0 if it
+ * cannot be read.
+ */
+size_t parseSize(const char* str){
+	char* end;
+	unsigned long long v = strtoull(str, &end, 10);
+	if (*end == 'k' || *end == 'K'){
+		v <<= 10;
+		end++;
+	} else if (*end == 'm' || *end == 'M'){
+		v <<= 20;
+		end++;
+	}
+	return *end == '\0' && v <= MAX_BLOCK ? v : 0;
+}
+
+/*
+ * Codes one block as a single frame into dst. Each call has its own
+ * writer, so blocks can be coded on separate threads.
+ *
+ * Returns false if the frame could not be written.
+ */
+bool encodeBlock(const Settings* s, const uint8_t* src, size_t count, std::string* dst){
+	std::ostringstream oss;
+	ArFrameWriter afw(&oss);
+	bool ok;
+
+	// USAGE OF LIBRARY
+	switch (s->engine){
+		case ENGINE_ADAPTIVE:
+			ok = afw.putAdaptiveFrame(src, count);
+			break;
+		case ENGINE_DEFERRED:
+			ok = afw.putDeferredFrame(src, count, 0x1 << (13 - s->level));
+			break;
+		case ENGINE_HUFFMAN:
+			ok = afw.putHuffmanFrame(NULL, src, count);
+			break;
+		case ENGINE_BWT:
+			ok = afw.putBwtFrame(src, count);
+			break;
+		case ENGINE_MIX:
+			ok = afw.putMixFrame(src, count, 12 + s->level);
+			break;
+		case ENGINE_REGISTERED:
+			ok = afw.putRegisteredFrame(s->reg, src, count);
+			break;
+		default:
+			ok = afw.putLzFrame(src, count, s->level);
+			break;
+	}
+	// END USAGE OF LIBRARY
+
+	*dst = oss.str();
+	return ok && !dst->empty();
+}
+
+/*
+ * Reads in a batch of up to one block per thread at a time, codes the
+ * batch in parallel, and writes the frames in order.
+ */
+bool compress(const Settings& s, std::istream& in, std::ostream& out, Stats* stats){
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	// USAGE OF LIBRARY
+	ArFrameWriter afw(&out);
+	afw.putStreamHeader();
+
+	std::vector<std::string> blocks(s.threads);
+	std::vector<std::string> frames(s.threads);
+	std::vector<char> coded(s.threads);
+	bool more = true;
+	while (more){
+		int n = 0;
+		for (; n < s.threads; n++){
+			blocks[n].resize(s.block);
+			in.read(&blocks[n][0], s.block);
+			blocks[n].resize(in.gcount());
+			if (blocks[n].empty()){
+				more = false;
+				break;
+			}
+		}
+
+		std::vector<std::thread> workers;
+		for (int i = 1; i < n; i++){
+			workers.push_back(std::thread([&s, &blocks, &frames, &coded, i](){
+				coded[i] = encodeBlock(&s, (const uint8_t*) blocks[i].data(), blocks[i].size(), &frames[i]);
+			}));
+		}
+		if (n > 0){
+			coded[0] = encodeBlock(&s, (const uint8_t*) blocks[0].data(), blocks[0].size(), &frames[0]);
+		}
+		for (size_t i = 0; i < workers.size(); i++){
+			workers[i].join();
+		}
+
+		for (int i = 0; i < n; i++){
+			if (!coded[i]){
+				return false;
+			}
+			out.write(frames[i].data(), frames[i].size());
+			stats->in += blocks[i].size();
+			stats->out += frames[i].size();
+			stats->frames[(uint8_t) frames[i][0]]++;
+		}
+	}
+
+	afw.finish();
+	// END USAGE OF LIBRARY
+
+	// The stream header and end marker
+	stats->out += 5;
+	stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	return out.good();
+}
+
+struct DecodeJob{
+	ArFrameHeader h;
+	std::string payload;
+	std::string block;
+	bool ok;
+};
+
+void decodeBlock(const Settings* s, DecodeJob* job){
+	job->block.resize(job->h.symbols);
+	job->ok = ArFrameReader::decodeFrame(NULL, s->reg, job->h, job->payload, (uint8_t*) &job->block[0]);
+}
+
+/*
+ * Reads a batch of up to one frame per thread at a time, decodes the
+ * batch in parallel, and writes the blocks in order.
+ */
+bool decompress(const Settings& s, std::istream& in, std::ostream& out, Stats* stats){
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	// USAGE OF LIBRARY
+	ArFrameReader afr(&in);
+	if (!afr.readStreamHeader()){
+		return false;
+	}
+
+	std::vector<DecodeJob> jobs(s.threads);
+	bool more = true;
+	while (more){
+		int n = 0;
+		for (; n < s.threads; n++){
+			if (!afr.next(&jobs[n].h)){
+				more = false;
+				break;
+			}
+			if (jobs[n].h.symbols > MAX_BLOCK || jobs[n].h.length > MAX_BLOCK || !afr.readPayload(jobs[n].h, &jobs[n].payload)){
+				return false;
+			}
+			stats->in += 9 + jobs[n].h.length;
+		}
+
+		std::vector<std::thread> workers;
+		for (int i = 1; i < n; i++){
+			workers.push_back(std::thread(decodeBlock, &s, &jobs[i]));
+		}
+		if (n > 0){
+			decodeBlock(&s, &jobs[0]);
+		}
+		for (size_t i = 0; i < workers.size(); i++){
+			workers[i].join();
+		}
+
+		for (int i = 0; i < n; i++){
+			if (!jobs[i].ok){
+				return false;
+			}
+			out.write(jobs[i].block.data(), jobs[i].block.size());
+			stats->out += jobs[i].block.size();
+			stats->frames[jobs[i].h.engine]++;
+		}
+	}
+	// END USAGE OF LIBRARY
+
+	// The stream header and end marker
+	stats->in += 5;
+	stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	// A stream cut short, even at a frame boundary, is not a whole stream
+	return afr.atEnd() && out.good();
+}
+
+/*
+ * Compresses and decompresses the whole input in memory, with the
+ * engine given or with every engine, and reports the size and speed.
+ */
+int bench(const Settings& s, std::istream& in, bool all){
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	std::cout << "Input: " << data.size() << " bytes, " << s.threads << " thread(s), blocks of " << s.block << " bytes\n";
+	std::cout << "Engine		Level	Size		Bits/byte	Compress MB/s	Decompress MB/s\n";
+
+	for (int i = 0; i < engineCount; i++){
+		Settings t = s;
+		if (all){
+			t.engine = engines[i].id;
+			if (t.engine == ENGINE_REGISTERED && t.reg == NULL){
+				continue;
+			}
+		} else if (i > 0){
+			break;
+		}
+
+		Stats enc;
+		Stats dec;
+		memset(&enc, 0, sizeof(enc));
+		memset(&dec, 0, sizeof(dec));
+
+		std::istringstream src(data);
+		std::stringstream packed;
+		compress(t, src, packed, &enc);
+		std::ostringstream unpacked;
+		bool ok = decompress(t, packed, unpacked, &dec) && unpacked.str() == data;
+
+		double mb = data.size() / 1e6;
+		std::cout << engineName(t.engine) << (strlen(engineName(t.engine)) < 8 ? "\t\t" : "\t") << t.level;
+		std::cout << "\t" << enc.out << "\t\t" << (data.empty() ? 0 : 8.0 * enc.out / data.size());
+		std::cout << "\t\t" << mb / enc.seconds << "\t\t" << mb / dec.seconds;
+		std::cout << (ok ? "" : "\tINCORRECT") << "\n";
+	}
+
+	return 0;
+}
+
+void printStats(const Stats& stats, bool decoding){
+	uint64_t raw = decoding ? stats.out : stats.in;
+	uint64_t packed = decoding ? stats.in : stats.out;
+
+	std::cerr << "arc: " << stats.in << " -> " << stats.out << " bytes";
+	if (raw > 0){
+		std::cerr << ", " << 8.0 * packed / raw << " bits/byte";
+	}
+	if (stats.seconds > 0){
+		std::cerr << ", " << raw / 1e6 / stats.seconds << " MB/s";
+	}
+	std::cerr << "\narc: frames:";
+	for (int i = 0; i < 256; i++){
+		if (stats.frames[i]){
+			std::cerr << " " << engineName(i) << " " << stats.frames[i];
+		}
+	}
+	std::cerr << "\n";
+}